@@ -0,0 +1,215 @@
+#include "batch.h"
+#include "queue.h"
+#include "io.h"
+#include "score.h"
+#include "greedy.h"
+#include "localsearch.h"
+#include "hall.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Parsed instance waiting for a solver
+struct BatchJob {
+    BatchResult result;
+    Instance inst;
+    Event event; // multi-hall files fill this instead of inst
+};
+
+// Solved instance waiting for the writer
+struct BatchDone {
+    BatchResult result;
+    Layout layout;
+    vector<Layout> halls; // one layout per hall for multi-hall files
+};
+
+static double MsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+vector<string> ListBatchFiles(const string& manifest_or_dir) {
+    vector<string> files;
+    if (fs::is_directory(manifest_or_dir)) {
+        for (const auto& entry : fs::directory_iterator(manifest_or_dir)) {
+            string ext = entry.path().extension().string();
+            if (entry.is_regular_file() && (ext == ".txt" || ext == ".bin")) {
+                files.push_back(entry.path().string());
+            }
+        }
+        sort(files.begin(), files.end());
+        return files;
+    }
+
+    ifstream in(manifest_or_dir);
+    if (!in) {
+        cerr << "Error: cannot open " << manifest_or_dir << endl;
+        return files;
+    }
+    // manifest paths are relative to the manifest itself
+    fs::path base = fs::path(manifest_or_dir).parent_path();
+    string line;
+    while (getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t\r\n");
+        if (start == string::npos || line[start] == '#') continue;
+        size_t end = line.find_last_not_of(" \t\r\n");
+        fs::path p = line.substr(start, end - start + 1);
+        files.push_back(p.is_absolute() ? p.string() : (base / p).string());
+    }
+    return files;
+}
+
+// Output name of each file: its stem, or stem.index when another file in
+// the batch has the same stem (a/x.txt and b/x.txt, or x.txt and x.bin)
+static vector<string> LayoutNames(const vector<string>& files) {
+    vector<string> names;
+    map<string, int> uses;
+    for (const auto& f : files) {
+        names.push_back(fs::path(f).stem().string());
+        uses[names.back()]++;
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        if (uses[names[i]] > 1) names[i] += "." + to_string(i);
+    }
+    return names;
+}
+
+static void WriteSummaryHeader(ofstream& out) {
+    out << "index,file,status,seed,score,exposure,row_clash,across_clash,"
+           "parse_ms,solve_ms\n";
+}
+
+// Quote a CSV field if it needs it
+static string CsvField(const string& s) {
+    if (s.find_first_of(",\"\n") == string::npos) return s;
+    string q = "\"";
+    for (char ch : s) {
+        if (ch == '"') q += '"';
+        q += ch;
+    }
+    return q + "\"";
+}
+
+static void WriteSummaryLine(ofstream& out, const BatchResult& r) {
+    out << r.index << "," << CsvField(r.file) << ","
+        << CsvField(r.ok ? "ok" : r.error) << ","
+        << r.seed << "," << r.score << "," << r.exposure << ","
+        << r.row_clash << "," << r.across_clash << ","
+        << r.parse_ms << "," << r.solve_ms << "\n";
+}
+
+vector<BatchResult> RunBatch(const vector<string>& files, const string& out_dir,
+                             const Params& params, int max_iters,
+                             int workers, int queue_size) {
+    fs::create_directories(out_dir);
+    if (workers < 1) workers = 1;
+
+    BoundedQueue<BatchJob> jobs(queue_size);
+    BoundedQueue<BatchDone> done(queue_size);
+    vector<BatchResult> results(files.size());
+
+    // I/O thread: parse ahead of the solvers
+    thread reader([&]() {
+        for (size_t i = 0; i < files.size(); i++) {
+            BatchJob job;
+            job.result.index = i;
+            job.result.file = files[i];
+            job.result.seed = params.seed + (unsigned)i;
+            auto start = chrono::steady_clock::now();
+            ParseError err;
+            bool parsed = IsEventFile(files[i])
+                              ? ParseEvent(files[i], params, job.event, err)
+                              : ParseInstance(files[i], params, job.inst, err);
+            if (parsed) {
+                job.inst.params.seed = job.result.seed;
+                job.result.ok = true;
+            } else if (err.line > 0) {
+                job.result.error = to_string(err.line) + ":" + to_string(err.col) +
+                                   ": " + err.message;
+            } else {
+                job.result.error = err.message;
+            }
+            job.result.parse_ms = MsSince(start);
+            jobs.Push(move(job));
+        }
+        jobs.Close();
+    });
+
+    // solver threads
+    vector<thread> solvers;
+    for (int w = 0; w < workers; w++) {
+        solvers.emplace_back([&]() {
+            BatchJob job;
+            while (jobs.Pop(job)) {
+                BatchDone out;
+                out.result = job.result;
+                if (job.result.ok && !job.event.halls.empty()) {
+                    // a multi-hall event: the summary gets the combined totals
+                    auto start = chrono::steady_clock::now();
+                    EventResult solved = SolveEvent(job.event, max_iters, out.result.seed, 10);
+                    out.result.solve_ms = MsSince(start);
+                    for (const auto& parts : solved.parts) {
+                        out.result.exposure += parts.exposure;
+                        out.result.row_clash += parts.row_clash;
+                        out.result.across_clash += parts.across_clash;
+                    }
+                    out.result.score = solved.score;
+                    out.halls = move(solved.halls);
+                } else if (job.result.ok) {
+                    auto start = chrono::steady_clock::now();
+                    out.layout.inst = move(job.inst);
+                    SeedLayout(out.layout);
+                    LocalSearch(out.layout, max_iters, out.result.seed);
+                    out.result.solve_ms = MsSince(start);
+
+                    ScoreParts parts = ComputeScoreParts(out.layout);
+                    out.result.exposure = parts.exposure;
+                    out.result.row_clash = parts.row_clash;
+                    out.result.across_clash = parts.across_clash;
+                    out.result.score = parts.Score(params.wC, params.wX);
+                }
+                done.Push(move(out));
+            }
+        });
+    }
+
+    // writer thread: layouts and the summary file. Rows are written in
+    // input order, so the summary does not depend on worker scheduling.
+    vector<string> names = LayoutNames(files);
+    thread writer([&]() {
+        ofstream summary(out_dir + "/summary.csv");
+        WriteSummaryHeader(summary);
+        vector<bool> finished(files.size(), false);
+        size_t next_row = 0;
+        BatchDone out;
+        while (done.Pop(out)) {
+            if (out.result.ok) {
+                const string& name = names[out.result.index];
+                if (out.halls.empty()) {
+                    WriteLayout(out_dir + "/" + name + ".layout", out.layout);
+                }
+                for (size_t h = 0; h < out.halls.size(); h++) {
+                    WriteLayout(out_dir + "/" + name + ".hall" + to_string(h) + ".layout",
+                                out.halls[h]);
+                }
+            }
+            results[out.result.index] = out.result;
+            finished[out.result.index] = true;
+            while (next_row < files.size() && finished[next_row]) {
+                WriteSummaryLine(summary, results[next_row++]);
+            }
+        }
+    });
+
+    reader.join();
+    for (auto& t : solvers) t.join();
+    done.Close();
+    writer.join();
+    return results;
+}
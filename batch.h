@@ -0,0 +1,40 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "model.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Per-instance line of the batch summary
+struct BatchResult {
+    int index = 0;
+    string file;
+    bool ok = false;
+    string error;
+    unsigned seed = 0;
+    double score = 0.0;
+    double exposure = 0.0;
+    double row_clash = 0;
+    double across_clash = 0;
+    double parse_ms = 0.0;
+    double solve_ms = 0.0;
+};
+
+// List the instance files of a batch: either every *.txt and *.bin file
+// in a directory (sorted) or the paths in a manifest file, one per line
+vector<string> ListBatchFiles(const string& manifest_or_dir);
+
+// Solve many instances in one process. One thread parses ahead, `workers`
+// threads solve, and one thread writes <out_dir>/<name>.layout files and
+// <out_dir>/summary.csv (rows in input order). <name> is the file's stem,
+// with .<index> added when several files share a stem. Multi-hall files get one <name>.hall<h>.layout per
+// hall and their combined totals in the summary. The queues between the
+// stages hold at most `queue_size` instances so memory stays bounded.
+// Instance i is solved with seed params.seed + i.
+vector<BatchResult> RunBatch(const vector<string>& files, const string& out_dir,
+                             const Params& params, int max_iters,
+                             int workers, int queue_size);
+
+#endif
@@ -0,0 +1,335 @@
+#include "model.h"
+#include "io.h"
+#include "binio.h"
+#include "score.h"
+#include "greedy.h"
+#include "localsearch.h"
+#include "generator.h"
+#include "trace.h"
+#include "output.h"
+#include "rng.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+
+// Scaling benchmark: times parsing, construction, local search and every
+// scoring function on generated instances from 10^2 to 10^6 slots and
+// writes the medians and percentiles as CSV and JSON.
+
+// The getline/istringstream reader that ParseInstance replaced, kept here
+// as the baseline for the parser benchmark
+static bool ReadLine(ifstream& in, string& line) {
+    while (getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t\r\n");
+        if (start == string::npos) continue;
+        line = line.substr(start);
+        if (line[0] == '#') continue;
+        return true;
+    }
+    return false;
+}
+
+static Instance ReadInstanceStream(const string& filename, const Params& params) {
+    Instance inst;
+    inst.params = params;
+    ifstream in(filename);
+    string line;
+
+    ReadLine(in, line);
+    istringstream iss1(line);
+    iss1 >> inst.params.rows >> inst.params.cols;
+
+    ReadLine(in, line);
+    int num_booths;
+    istringstream iss2(line);
+    iss2 >> num_booths;
+
+    inst.booths.resize(num_booths);
+    for (int i = 0; i < num_booths; i++) {
+        ReadLine(in, line);
+        istringstream iss(line);
+        iss >> inst.booths[i].id >> inst.booths[i].category >> inst.booths[i].value;
+    }
+
+    inst.slots.resize(inst.params.rows * inst.params.cols);
+    for (int r = 0; r < inst.params.rows; r++) {
+        for (int c = 0; c < inst.params.cols; c++) {
+            int idx = inst.index(r, c);
+            inst.slots[idx].r = r;
+            inst.slots[idx].c = c;
+        }
+    }
+
+    ReadLine(in, line);
+    int num_blocked;
+    istringstream iss3(line);
+    iss3 >> num_blocked;
+    for (int i = 0; i < num_blocked; i++) {
+        ReadLine(in, line);
+        int r, c;
+        istringstream iss(line);
+        iss >> r >> c;
+        inst.slots[inst.index(r, c)].blocked = true;
+    }
+
+    for (int r = 0; r < inst.params.rows; r++) {
+        ReadLine(in, line);
+        istringstream iss(line);
+        for (int c = 0; c < inst.params.cols; c++) {
+            iss >> inst.slots[inst.index(r, c)].bonus;
+        }
+    }
+    CompileInstance(inst);
+    return inst;
+}
+
+// Same placement as GreedyValueOnly (best booth to best free slot) in
+// O(n log n), so the larger sizes can be set up quickly
+static void SortedSeed(Layout& L) {
+    vector<int> booths(L.inst.booths.size()), slots;
+    for (size_t i = 0; i < booths.size(); i++) booths[i] = i;
+    for (size_t i = 0; i < L.inst.slots.size(); i++) {
+        if (!L.inst.slots[i].blocked) slots.push_back(i);
+    }
+    stable_sort(booths.begin(), booths.end(), [&](int a, int b) {
+        return L.inst.booths[a].value > L.inst.booths[b].value;
+    });
+    stable_sort(slots.begin(), slots.end(), [&](int a, int b) {
+        return L.inst.slots[a].bonus > L.inst.slots[b].bonus;
+    });
+    for (size_t i = 0; i < booths.size() && i < slots.size(); i++) {
+        L.inst.slots[slots[i]].booth_id = booths[i];
+    }
+}
+
+// Timings of one function at one instance size
+struct BenchRow {
+    string function;
+    int rows, cols, booths;
+    vector<double> samples_ms; // per call
+};
+
+// Largest instance (in slots) each function is run on by default, so the
+// suite finishes in minutes with the current algorithms. --no-limits lifts them.
+static const map<string, long> kDefaultMaxSlots = {
+    {"greedy_seed", 1000},
+    {"greedy_value_only", 10000},
+    {"local_search", 10000},
+    {"local_search_traced", 10000},
+};
+
+static double Percentile(vector<double> v, double p) {
+    sort(v.begin(), v.end());
+    size_t rank = (size_t)ceil(p / 100.0 * v.size());
+    return v[rank ? rank - 1 : 0];
+}
+
+template <typename F>
+static double TimeMs(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static void WriteCsv(const string& filename, const vector<BenchRow>& rows) {
+    ofstream out(filename);
+    out << "function,rows,cols,slots,booths,repeats,median_ms,p90_ms,p99_ms,min_ms,max_ms\n";
+    for (const auto& r : rows) {
+        const auto& s = r.samples_ms;
+        out << r.function << "," << r.rows << "," << r.cols << ","
+            << (long)r.rows * r.cols << "," << r.booths << "," << s.size() << ","
+            << Percentile(s, 50) << "," << Percentile(s, 90) << ","
+            << Percentile(s, 99) << "," << *min_element(s.begin(), s.end()) << ","
+            << *max_element(s.begin(), s.end()) << "\n";
+    }
+}
+
+static void WriteJson(const string& filename, const vector<BenchRow>& rows,
+                      uint64_t seed) {
+    ofstream out(filename);
+    out << "{\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"seed\": " << seed
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const BenchRow& r = rows[i];
+        const auto& s = r.samples_ms;
+        out << "    {\"function\": \"" << r.function << "\", \"rows\": " << r.rows
+            << ", \"cols\": " << r.cols << ", \"slots\": " << (long)r.rows * r.cols
+            << ", \"booths\": " << r.booths << ", \"repeats\": " << s.size()
+            << ", \"median_ms\": " << Percentile(s, 50)
+            << ", \"p90_ms\": " << Percentile(s, 90)
+            << ", \"p99_ms\": " << Percentile(s, 99)
+            << ", \"min_ms\": " << *min_element(s.begin(), s.end())
+            << ", \"max_ms\": " << *max_element(s.begin(), s.end())
+            << ", \"samples_ms\": [";
+        for (size_t k = 0; k < s.size(); k++) out << (k ? ", " : "") << s[k];
+        out << "]}" << (i + 1 < rows.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    int repeats = 5;
+    long max_slots = 1000000;
+    bool limits = true;
+    uint64_t seed = 1;
+    string csv = "bench_results.csv", json = "bench_results.json";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--repeats" && has_value) {
+            repeats = max(1, atoi(argv[++i]));
+        } else if (arg == "--max-slots" && has_value) {
+            max_slots = atol(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--csv" && has_value) {
+            csv = argv[++i];
+        } else if (arg == "--json" && has_value) {
+            json = argv[++i];
+        } else if (arg == "--no-limits") {
+            limits = false;
+        } else {
+            cerr << "Usage: ./bench [--repeats n] [--max-slots n] [--seed s]" << endl;
+            cerr << "               [--csv file] [--json file] [--no-limits]" << endl;
+            return 1;
+        }
+    }
+
+    // 10^2 .. 10^6 slots
+    const vector<pair<int, int>> sizes = {
+        {10, 10}, {25, 40}, {100, 100}, {250, 400}, {1000, 1000},
+    };
+
+    vector<BenchRow> results;
+    Params params;
+    cout << setw(20) << left << "function" << right << setw(10) << "slots"
+         << setw(14) << "median ms" << setw(14) << "p90 ms" << endl;
+
+    for (auto [rows, cols] : sizes) {
+        long slots = (long)rows * cols;
+        if (slots > max_slots) break;
+
+        GenParams g;
+        g.rows = rows;
+        g.cols = cols;
+        g.categories = 6;
+        g.seed = seed;
+        Instance inst = GenerateInstance(g, params);
+        string text = "/tmp/layout_bench_" + to_string(getpid()) + ".txt";
+        string bin = text + ".bin";
+        WriteInstance(text, inst);
+        WriteBinaryInstance(bin, inst, false, false);
+
+        Layout seeded;
+        seeded.inst = inst;
+        SortedSeed(seeded);
+
+        // random moves between placed booths and to empty slots, as slot
+        // indices like local search uses, drawn before any timing starts
+        mt19937_64 rng(seed);
+        vector<int> placed, empty;
+        for (size_t i = 0; i < seeded.inst.slots.size(); i++) {
+            const Slot& s = seeded.inst.slots[i];
+            if (s.booth_id >= 0) placed.push_back(i);
+            else if (!s.blocked) empty.push_back(i);
+        }
+        const int kMoves = 1000;
+        vector<pair<int, int>> relocates, swaps;
+        for (int k = 0; k < kMoves && !placed.empty() && !empty.empty(); k++) {
+            relocates.push_back({placed[rng() % placed.size()], empty[rng() % empty.size()]});
+        }
+        for (int k = 0; k < kMoves && placed.size() >= 2; k++) {
+            size_t a = rng() % placed.size(), b = rng() % (placed.size() - 1);
+            if (b >= a) b++;
+            swaps.push_back({placed[a], placed[b]});
+        }
+
+        auto run = [&](const string& name, int calls, auto body) {
+            auto it = kDefaultMaxSlots.find(name);
+            if (limits && it != kDefaultMaxSlots.end() && slots > it->second) return;
+            BenchRow row{name, rows, cols, (int)inst.booths.size(), {}};
+            for (int rep = 0; rep < repeats; rep++) {
+                row.samples_ms.push_back(TimeMs([&] {
+                    for (int k = 0; k < calls; k++) body();
+                }) / calls);
+            }
+            cout << setw(20) << left << name << right << setw(10) << slots
+                 << setw(14) << Percentile(row.samples_ms, 50)
+                 << setw(14) << Percentile(row.samples_ms, 90) << endl;
+            results.push_back(row);
+        };
+
+        ParseError err;
+        Instance parsed;
+        run("read_text", 1, [&] { parsed = ReadInstance(text, params); });
+        run("read_text_stream", 1, [&] { parsed = ReadInstanceStream(text, params); });
+        run("read_binary", 1, [&] { ParseInstance(bin, params, parsed, err); });
+
+        Layout L;
+        run("greedy_seed", 1, [&] { L.inst = inst; GreedySeed(L); });
+        run("greedy_value_only", 1, [&] { L.inst = inst; GreedyValueOnly(L); });
+        run("colored_seed", 1, [&] { L.inst = inst; ColoredSeed(L); });
+        run("local_search", 1, [&] { L = seeded; LocalSearch(L, 10, seed); });
+        StartTrace(1 << 16);
+        run("local_search_traced", 1, [&] { L = seeded; LocalSearch(L, 10, seed); });
+        StopTrace();
+
+        double sink = 0.0;
+        run("compute_exposure", 1, [&] { sink += ComputeExposure(seeded); });
+        run("compute_row_clash", 1, [&] { sink += ComputeRowClash(seeded); });
+        run("compute_across_clash", 1, [&] { sink += ComputeAcrossAisleClash(seeded); });
+        run("compute_total_score", 1, [&] { sink += ComputeTotalScore(seeded); });
+        size_t next_move = 0;
+        if (!relocates.empty()) {
+            run("delta_relocate", kMoves, [&] {
+                auto [from, to] = relocates[next_move++ % kMoves];
+                sink += DeltaRelocateSlots(seeded, from, to);
+            });
+        }
+        if (!swaps.empty()) {
+            run("delta_swap", kMoves, [&] {
+                auto [a, b] = swaps[next_move++ % kMoves];
+                sink += DeltaSwapSlots(seeded, a, b);
+            });
+        }
+
+        // layout output, formatted in memory plus one write of the grid
+        string out_file = text + ".layout";
+        run("format_grid", 1, [&] { sink += FormatLayout(seeded, LayoutFormat::Grid).size(); });
+        run("format_csv", 1, [&] { sink += FormatLayout(seeded, LayoutFormat::Csv).size(); });
+        run("format_json", 1, [&] { sink += FormatLayout(seeded, LayoutFormat::Json).size(); });
+        run("write_layout", 1, [&] { WriteLayout(out_file, seeded); });
+        remove(out_file.c_str());
+
+        // one draw per placed booth: the solver's generator against mt19937
+        int draws = max<int>(1, placed.size());
+        Rng stream(seed, 1);
+        mt19937 mt((unsigned)seed);
+        run("rng_xoshiro", 1, [&] {
+            for (int k = 0; k < draws; k++) sink += stream.Below(1000);
+        });
+        run("rng_mt19937", 1, [&] {
+            uniform_int_distribution<int> dist(0, 999);
+            for (int k = 0; k < draws; k++) sink += dist(mt);
+        });
+        if (sink == 12345.678) cout << ""; // keep the results alive
+
+        remove(text.c_str());
+        remove(bin.c_str());
+    }
+
+    WriteCsv(csv, results);
+    WriteJson(json, results, seed);
+    cout << "Wrote " << csv << " and " << json << endl;
+    return 0;
+}
@@ -0,0 +1,344 @@
+#include "binio.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const size_t kAlign = 64;
+
+static size_t AlignUp(size_t n) {
+    return (n + kAlign - 1) / kAlign * kAlign;
+}
+
+MappedBinary::~MappedBinary() {
+    if (data) munmap(data, size);
+}
+
+bool IsBinaryInstance(const char* data, size_t size) {
+    return size >= sizeof(kBinMagic) && memcmp(data, kBinMagic, sizeof(kBinMagic)) == 0;
+}
+
+// out = a * b, false if that overflows size_t
+static bool MulSize(size_t a, size_t b, size_t& out) {
+    if (b != 0 && a > SIZE_MAX / b) return false;
+    out = a * b;
+    return true;
+}
+
+static bool BinFail(ParseError& err, const string& message) {
+    err = ParseError{0, 0, message};
+    return false;
+}
+
+bool ViewBinaryInstance(const char* data, size_t size, BinaryInstanceView& view,
+                        ParseError& err) {
+    view = BinaryInstanceView();
+    if (size < sizeof(BinHeader) || !IsBinaryInstance(data, size)) {
+        return BinFail(err, "not a binary instance");
+    }
+    const BinHeader* h = (const BinHeader*)data;
+    if (h->byte_order != kBinByteOrder) return BinFail(err, "wrong byte order");
+    if (h->version != kBinVersion) {
+        return BinFail(err, "unsupported binary version " + to_string(h->version));
+    }
+    if (h->rows <= 0 || h->cols <= 0 || h->num_booths < 0 || h->num_categories < 0) {
+        return BinFail(err, "bad dimensions in header");
+    }
+    if (h->section_table > size ||
+        (size - h->section_table) / sizeof(BinSection) < h->num_sections) {
+        return BinFail(err, "section table outside the file");
+    }
+
+    // same cap as the text parser, so a header cannot ask for a huge grid
+    if ((long long)h->rows * h->cols > kMaxGridSlots) {
+        return BinFail(err, "grid too large (more than " + to_string(kMaxGridSlots) +
+                                " slots)");
+    }
+    size_t slots = (size_t)h->rows * h->cols;
+    size_t bonus_width = (h->flags & kBinBonusFloat32) ? sizeof(float) : sizeof(double);
+    size_t offsets_size, booths_size, blocked_size, bonus_size, assignment_size;
+    if (!MulSize((size_t)h->num_categories + 1, sizeof(uint32_t), offsets_size) ||
+        !MulSize((size_t)h->num_booths, sizeof(BinBooth), booths_size) ||
+        !MulSize((slots + 63) / 64, sizeof(uint64_t), blocked_size) ||
+        !MulSize(slots, bonus_width, bonus_size) ||
+        !MulSize(slots, sizeof(int32_t), assignment_size)) {
+        return BinFail(err, "bad dimensions in header");
+    }
+    const BinSection* table = (const BinSection*)(data + h->section_table);
+
+    // expected size of every known section; none can be larger than the file
+    map<uint32_t, size_t> expected = {
+        {kSecCategoryOffsets, offsets_size},
+        {kSecBooths, booths_size},
+        {kSecBlocked, blocked_size},
+        {kSecBonus, bonus_size},
+        {kSecAssignment, assignment_size},
+    };
+    for (const auto& e : expected) {
+        if (e.second > size) return BinFail(err, "header sizes do not fit the file");
+    }
+    map<uint32_t, const char*> found;
+    for (uint32_t i = 0; i < h->num_sections; i++) {
+        const BinSection& s = table[i];
+        if (s.offset % kAlign != 0 || s.offset > size || s.size > size - s.offset) {
+            return BinFail(err, "section " + to_string(s.tag) + " outside the file");
+        }
+        auto it = expected.find(s.tag);
+        if (it != expected.end() && it->second != s.size) {
+            return BinFail(err, "section " + to_string(s.tag) + " has the wrong size");
+        }
+        if ((s.tag == kSecConflicts && s.size % sizeof(BinConflict) != 0) ||
+            (s.tag == kSecRules && s.size % sizeof(BinRule) != 0)) {
+            return BinFail(err, "section " + to_string(s.tag) + " has the wrong size");
+        }
+        found[s.tag] = data + s.offset;
+        if (s.tag == kSecCategoryChars) expected[kSecCategoryChars] = s.size;
+        if (s.tag == kSecConflicts || s.tag == kSecRules) expected[s.tag] = s.size;
+    }
+    for (uint32_t tag : {kSecCategoryOffsets, kSecCategoryChars, kSecBooths,
+                         kSecBlocked, kSecBonus}) {
+        if (!found.count(tag)) return BinFail(err, "missing section " + to_string(tag));
+    }
+    bool has_assignment = (h->flags & kBinHasAssignment) != 0;
+    if (has_assignment && !found.count(kSecAssignment)) {
+        return BinFail(err, "missing assignment section");
+    }
+
+    view.header = h;
+    view.rows = h->rows;
+    view.cols = h->cols;
+    view.num_booths = h->num_booths;
+    view.num_categories = h->num_categories;
+    view.category_offsets = (const uint32_t*)found[kSecCategoryOffsets];
+    view.category_chars = found[kSecCategoryChars];
+    view.booths = (const BinBooth*)found[kSecBooths];
+    view.blocked = (const uint64_t*)found[kSecBlocked];
+    if (h->flags & kBinBonusFloat32) {
+        view.bonus32 = (const float*)found[kSecBonus];
+    } else {
+        view.bonus64 = (const double*)found[kSecBonus];
+    }
+    if (has_assignment) view.assignment = (const int32_t*)found[kSecAssignment];
+    if (found.count(kSecConflicts)) {
+        view.conflicts = (const BinConflict*)found[kSecConflicts];
+        view.num_conflicts = expected[kSecConflicts] / sizeof(BinConflict);
+    }
+    if (found.count(kSecRules)) {
+        view.rules = (const BinRule*)found[kSecRules];
+        view.num_rules = expected[kSecRules] / sizeof(BinRule);
+    }
+
+    // check every index stored in the file so readers need no bounds checks
+    size_t chars = expected[kSecCategoryChars];
+    for (int k = 0; k < view.num_categories; k++) {
+        if (view.category_offsets[k] > view.category_offsets[k + 1] ||
+            view.category_offsets[k + 1] > chars) {
+            return BinFail(err, "bad category table");
+        }
+    }
+    for (int i = 0; i < view.num_booths; i++) {
+        if (view.booths[i].category < 0 || view.booths[i].category >= view.num_categories) {
+            return BinFail(err, "booth " + to_string(i) + " has a bad category");
+        }
+    }
+    for (int i = 0; i < view.num_conflicts; i++) {
+        const BinConflict& c = view.conflicts[i];
+        if (c.a < 0 || c.a >= view.num_categories || c.b < 0 || c.b >= view.num_categories) {
+            return BinFail(err, "conflict " + to_string(i) + " has a bad category");
+        }
+    }
+    for (int i = 0; i < view.num_rules; i++) {
+        const BinRule& rule = view.rules[i];
+        bool booth_ok = rule.booth_id >= 0 && rule.booth_id < view.num_booths &&
+                        rule.category == -1;
+        bool cat_ok = rule.booth_id == -1 && rule.category >= 0 &&
+                      rule.category < view.num_categories;
+        if ((!booth_ok && !cat_ok) || rule.r0 < 0 || rule.c0 < 0 || rule.r1 >= view.rows ||
+            rule.c1 >= view.cols || rule.r0 > rule.r1 || rule.c0 > rule.c1) {
+            return BinFail(err, "bad placement rule " + to_string(i));
+        }
+    }
+    if (view.assignment) {
+        vector<bool> seen(view.num_booths, false);
+        for (size_t i = 0; i < slots; i++) {
+            int b = view.assignment[i];
+            if (b == -1) continue;
+            if (b < 0 || b >= view.num_booths || seen[b] || view.Blocked(i)) {
+                return BinFail(err, "bad assignment at slot " + to_string(i));
+            }
+            seen[b] = true;
+        }
+    }
+    return true;
+}
+
+bool MapBinaryInstance(const string& filename, MappedBinary& mapped, ParseError& err) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+        if (fd >= 0) close(fd);
+        return BinFail(err, "cannot open " + filename);
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return BinFail(err, "cannot map " + filename);
+    mapped.data = data;
+    mapped.size = st.st_size;
+    return ViewBinaryInstance((const char*)data, mapped.size, mapped.view, err);
+}
+
+void BinaryToInstance(const BinaryInstanceView& view, const Params& params,
+                      Instance& inst) {
+    inst = Instance();
+    inst.params = params;
+    inst.params.rows = view.rows;
+    inst.params.cols = view.cols;
+
+    inst.booths.resize(view.num_booths);
+    for (int i = 0; i < view.num_booths; i++) {
+        inst.booths[i].id = view.booths[i].id;
+        inst.booths[i].category = string(view.Category(view.booths[i].category));
+        inst.booths[i].value = view.booths[i].value;
+    }
+
+    inst.slots.resize((size_t)view.rows * view.cols);
+    for (int r = 0; r < view.rows; r++) {
+        for (int c = 0; c < view.cols; c++) {
+            int idx = inst.index(r, c);
+            Slot& s = inst.slots[idx];
+            s.r = r;
+            s.c = c;
+            s.bonus = view.Bonus(idx);
+            s.blocked = view.Blocked(idx);
+            s.booth_id = view.assignment ? view.assignment[idx] : -1;
+        }
+    }
+
+    for (int i = 0; i < view.num_conflicts; i++) {
+        const BinConflict& c = view.conflicts[i];
+        inst.conflicts.push_back(CategoryConflict{string(view.Category(c.a)),
+                                                  string(view.Category(c.b)), c.weight});
+    }
+    for (int i = 0; i < view.num_rules; i++) {
+        const BinRule& r = view.rules[i];
+        string category = r.category >= 0 ? string(view.Category(r.category)) : "";
+        inst.rules.push_back(PlacementRule{r.allow != 0, r.booth_id, category,
+                                           r.r0, r.c0, r.r1, r.c1});
+    }
+    CompileInstance(inst);
+}
+
+// Append a section to the image, padded to the alignment
+static void AddSection(vector<char>& image, vector<BinSection>& table, uint32_t tag,
+                       const void* bytes, size_t size) {
+    image.resize(AlignUp(image.size()), 0);
+    table.push_back(BinSection{tag, 0, image.size(), size});
+    const char* p = (const char*)bytes;
+    image.insert(image.end(), p, p + size);
+}
+
+bool WriteBinaryInstance(const string& filename, const Instance& inst,
+                         bool with_assignment, bool float32_bonus) {
+    int rows = inst.params.rows, cols = inst.params.cols;
+    size_t slots = (size_t)rows * cols;
+
+    // intern category names in order of first use
+    map<string, int> cat_ids;
+    vector<uint32_t> cat_offsets = {0};
+    string cat_chars;
+    auto intern = [&](const string& name) {
+        auto it = cat_ids.find(name);
+        if (it == cat_ids.end()) {
+            it = cat_ids.emplace(name, (int)cat_ids.size()).first;
+            cat_chars += name;
+            cat_offsets.push_back(cat_chars.size());
+        }
+        return it->second;
+    };
+    vector<BinBooth> booths(inst.booths.size());
+    for (size_t i = 0; i < inst.booths.size(); i++) {
+        const Booth& b = inst.booths[i];
+        booths[i] = BinBooth{b.id, intern(b.category), b.value};
+    }
+    vector<BinConflict> conflicts;
+    for (const auto& c : inst.conflicts) {
+        conflicts.push_back(BinConflict{intern(c.a), intern(c.b), c.weight});
+    }
+    vector<BinRule> rules;
+    for (const auto& r : inst.rules) {
+        int cat = r.booth_id >= 0 ? -1 : intern(r.category);
+        rules.push_back(BinRule{r.allow, r.booth_id, cat, r.r0, r.c0, r.r1, r.c1, 0});
+    }
+
+    vector<uint64_t> blocked((slots + 63) / 64, 0);
+    vector<float> bonus32;
+    vector<double> bonus64;
+    vector<int32_t> assignment;
+    for (size_t i = 0; i < slots; i++) {
+        const Slot& s = inst.slots[i];
+        if (s.blocked) blocked[i >> 6] |= 1ull << (i & 63);
+        if (float32_bonus) {
+            bonus32.push_back((float)s.bonus);
+        } else {
+            bonus64.push_back(s.bonus);
+        }
+        if (with_assignment) assignment.push_back(s.booth_id);
+    }
+
+    BinHeader header = {};
+    memcpy(header.magic, kBinMagic, sizeof(kBinMagic));
+    header.version = kBinVersion;
+    header.byte_order = kBinByteOrder;
+    header.flags = (float32_bonus ? kBinBonusFloat32 : 0) |
+                   (with_assignment ? kBinHasAssignment : 0);
+    header.rows = rows;
+    header.cols = cols;
+    header.num_booths = inst.booths.size();
+    header.num_categories = cat_ids.size();
+
+    vector<char> image(sizeof(BinHeader), 0);
+    vector<BinSection> table;
+    AddSection(image, table, kSecCategoryOffsets, cat_offsets.data(),
+               cat_offsets.size() * sizeof(uint32_t));
+    AddSection(image, table, kSecCategoryChars, cat_chars.data(), cat_chars.size());
+    AddSection(image, table, kSecBooths, booths.data(), booths.size() * sizeof(BinBooth));
+    AddSection(image, table, kSecBlocked, blocked.data(), blocked.size() * sizeof(uint64_t));
+    if (float32_bonus) {
+        AddSection(image, table, kSecBonus, bonus32.data(), slots * sizeof(float));
+    } else {
+        AddSection(image, table, kSecBonus, bonus64.data(), slots * sizeof(double));
+    }
+    if (with_assignment) {
+        AddSection(image, table, kSecAssignment, assignment.data(), slots * sizeof(int32_t));
+    }
+    if (!conflicts.empty()) {
+        AddSection(image, table, kSecConflicts, conflicts.data(),
+                   conflicts.size() * sizeof(BinConflict));
+    }
+    if (!rules.empty()) {
+        AddSection(image, table, kSecRules, rules.data(), rules.size() * sizeof(BinRule));
+    }
+
+    image.resize(AlignUp(image.size()), 0);
+    header.num_sections = table.size();
+    header.section_table = image.size();
+    const char* t = (const char*)table.data();
+    image.insert(image.end(), t, t + table.size() * sizeof(BinSection));
+    memcpy(image.data(), &header, sizeof(header));
+
+    ofstream out(filename, ios::binary);
+    if (!out) {
+        cerr << "Error: cannot write to " << filename << endl;
+        return false;
+    }
+    out.write(image.data(), image.size());
+    return (bool)out;
+}
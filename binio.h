@@ -0,0 +1,147 @@
+#ifndef BINIO_H
+#define BINIO_H
+
+#include "model.h"
+#include "io.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Versioned binary format for instances and solved layouts.
+//
+// The file is a fixed header, a section table, and sections that each
+// start on a 64-byte boundary. All numbers are little-endian. The solver
+// loads it through BinaryToInstance, which copies the arrays into an
+// Instance without any text parsing; BinaryInstanceView reads a mapped
+// file in place for tools that only inspect it.
+//
+//   CATEGORY_OFFSETS  uint32[num_categories + 1] into CATEGORY_CHARS
+//   CATEGORY_CHARS    category names, not terminated
+//   BOOTHS            BinBooth[num_booths]
+//   BLOCKED           uint64 bitmap, bit i set = slot i blocked
+//   BONUS             float32 or float64 [rows * cols] (see kBinBonusFloat32)
+//   ASSIGNMENT        optional int32 [rows * cols], booth id or -1
+//   CONFLICTS         optional BinConflict[], category pair weights
+//   RULES             optional BinRule[], placement rules
+
+const char kBinMagic[8] = {'B', 'O', 'O', 'T', 'H', 'B', 'I', 'N'};
+const uint32_t kBinVersion = 1;
+const uint32_t kBinByteOrder = 0x01020304;
+
+// header flags
+const uint32_t kBinBonusFloat32 = 1u << 0;
+const uint32_t kBinHasAssignment = 1u << 1;
+
+enum BinSectionTag : uint32_t {
+    kSecCategoryOffsets = 1,
+    kSecCategoryChars = 2,
+    kSecBooths = 3,
+    kSecBlocked = 4,
+    kSecBonus = 5,
+    kSecAssignment = 6,
+    kSecConflicts = 7,
+    kSecRules = 8,
+};
+
+struct BinHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t flags;
+    int32_t rows, cols;
+    int32_t num_booths;
+    int32_t num_categories;
+    uint32_t num_sections;
+    uint64_t section_table; // file offset of BinSection[num_sections]
+    uint8_t reserved[16];
+};
+static_assert(sizeof(BinHeader) == 64, "binary header must stay 64 bytes");
+
+struct BinSection {
+    uint32_t tag;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct BinBooth {
+    int32_t id;
+    int32_t category; // index into the category table
+    double value;
+};
+
+struct BinConflict {
+    int32_t a, b;     // indices into the category table
+    double weight;
+};
+
+struct BinRule {
+    int32_t allow;    // 1 = allow, 0 = forbid
+    int32_t booth_id; // -1 for a category rule
+    int32_t category; // index into the category table, -1 for a booth rule
+    int32_t r0, c0, r1, c1;
+    int32_t reserved;
+};
+
+// Read-only view of a mapped binary file. Pointers point into the mapping.
+struct BinaryInstanceView {
+    const BinHeader* header = nullptr;
+    int rows = 0, cols = 0;
+    int num_booths = 0;
+    int num_categories = 0;
+    const uint32_t* category_offsets = nullptr;
+    const char* category_chars = nullptr;
+    const BinBooth* booths = nullptr;
+    const uint64_t* blocked = nullptr;
+    const float* bonus32 = nullptr;  // one of bonus32/bonus64 is set
+    const double* bonus64 = nullptr;
+    const int32_t* assignment = nullptr; // null if the file has none
+    const BinConflict* conflicts = nullptr;
+    int num_conflicts = 0;
+    const BinRule* rules = nullptr;
+    int num_rules = 0;
+
+    string_view Category(int k) const {
+        return string_view(category_chars + category_offsets[k],
+                           category_offsets[k + 1] - category_offsets[k]);
+    }
+    bool Blocked(int idx) const { return (blocked[idx >> 6] >> (idx & 63)) & 1; }
+    double Bonus(int idx) const { return bonus32 ? bonus32[idx] : bonus64[idx]; }
+};
+
+// A binary file mapped into memory; unmapped when destroyed
+struct MappedBinary {
+    void* data = nullptr;
+    size_t size = 0;
+    BinaryInstanceView view;
+
+    MappedBinary() = default;
+    MappedBinary(const MappedBinary&) = delete;
+    MappedBinary& operator=(const MappedBinary&) = delete;
+    ~MappedBinary();
+};
+
+// true if the buffer starts with the binary magic
+bool IsBinaryInstance(const char* data, size_t size);
+
+// Validate a binary image in memory and fill in a view of it
+bool ViewBinaryInstance(const char* data, size_t size, BinaryInstanceView& view,
+                        ParseError& err);
+
+// Map a binary file read-only and validate it
+bool MapBinaryInstance(const string& filename, MappedBinary& mapped, ParseError& err);
+
+// Copy a view into an Instance (this is how ParseInstance, and so every
+// solver path, loads binary files); booth placements come from the
+// assignment section if there is one
+void BinaryToInstance(const BinaryInstanceView& view, const Params& params,
+                      Instance& inst);
+
+// Write an instance (and, if with_assignment, its booth placements) in the
+// binary format. float32_bonus halves the size of the bonus matrix.
+bool WriteBinaryInstance(const string& filename, const Instance& inst,
+                         bool with_assignment, bool float32_bonus);
+
+#endif
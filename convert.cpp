@@ -0,0 +1,71 @@
+#include "model.h"
+#include "io.h"
+#include "binio.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static bool EndsWith(const string& s, const string& suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Convert instances and layouts between the text and binary formats.
+// The input format is detected from the file, the output format from the
+// extension: .bin = binary, .layout = layout grid, anything else = text.
+int main(int argc, char** argv) {
+    vector<string> args;
+    string layout_file;
+    bool float32 = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--float32") {
+            float32 = true;
+        } else if (arg == "--layout" && i + 1 < argc) {
+            layout_file = argv[++i];
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() != 2) {
+        cerr << "Usage: ./convert <input> <output> [--layout grid.layout] [--float32]" << endl;
+        cerr << "  instance.txt  -> out.bin     text to binary" << endl;
+        cerr << "  instance.bin  -> out.txt     binary to text" << endl;
+        cerr << "  solved.bin    -> out.layout  binary layout to layout grid" << endl;
+        cerr << "  --layout adds the placements of a layout grid to the input" << endl;
+        return 1;
+    }
+
+    Params params;
+    Instance inst;
+    ParseError err;
+    if (!ParseInstance(args[0], params, inst, err)) {
+        cerr << "Error: " << args[0] << ":" << err.line << ":" << err.col << ": "
+             << err.message << endl;
+        return 1;
+    }
+    if (!layout_file.empty() && !ReadLayout(layout_file, inst, err)) {
+        cerr << "Error: " << layout_file << ":" << err.line << ":" << err.col << ": "
+             << err.message << endl;
+        return 1;
+    }
+
+    bool placed = false;
+    for (const auto& s : inst.slots) {
+        if (s.booth_id >= 0) placed = true;
+    }
+
+    const string& out = args[1];
+    if (EndsWith(out, ".bin")) {
+        return WriteBinaryInstance(out, inst, placed, float32) ? 0 : 1;
+    }
+    if (EndsWith(out, ".layout")) {
+        Layout layout;
+        layout.inst = inst;
+        WriteLayout(out, layout);
+        return 0;
+    }
+    return WriteInstance(out, inst) ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include "model.h"
+#include "io.h"
+#include "binio.h"
+#include "generator.h"
+#include <iostream>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+// Write a synthetic instance; a .bin output gets the binary format
+int main(int argc, char** argv) {
+    GenParams g;
+    string out;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        bool ok = true;
+        if (arg == "--rows" && has_value) {
+            g.rows = atoi(argv[++i]);
+        } else if (arg == "--cols" && has_value) {
+            g.cols = atoi(argv[++i]);
+        } else if (arg == "--fill" && has_value) {
+            g.fill = atof(argv[++i]);
+        } else if (arg == "--categories" && has_value) {
+            g.categories = atoi(argv[++i]);
+        } else if (arg == "--blocked" && has_value) {
+            g.blocked = atof(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            g.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--values" && has_value) {
+            ok = ParseValueDist(argv[++i], g.values);
+        } else if (arg == "--bonus" && has_value) {
+            ok = ParseBonusPattern(argv[++i], g.bonus);
+        } else if (arg.rfind("--", 0) != 0 && out.empty()) {
+            out = arg;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            cerr << "Bad argument: " << argv[i] << endl;
+            return 1;
+        }
+    }
+    if (out.empty() || g.rows <= 0 || g.cols <= 0) {
+        cerr << "Usage: ./gen <out.txt|out.bin> [--rows n] [--cols n] [--fill f]" << endl;
+        cerr << "       [--categories k] [--blocked p] [--seed s]" << endl;
+        cerr << "       [--values uniform|normal|heavy]" << endl;
+        cerr << "       [--bonus center|entrance|aisles|random]" << endl;
+        return 1;
+    }
+
+    Instance inst = GenerateInstance(g, Params());
+    bool binary = out.size() >= 4 && out.compare(out.size() - 4, 4, ".bin") == 0;
+    bool ok = binary ? WriteBinaryInstance(out, inst, false, false)
+                     : WriteInstance(out, inst);
+    if (!ok) return 1;
+    cout << "Wrote " << g.rows << "x" << g.cols << " instance with "
+         << inst.booths.size() << " booths to " << out << endl;
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "generator.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace std;
+
+// Draws from mt19937_64 without std distributions, whose output differs
+// between standard libraries, so instances are the same everywhere
+struct GenRng {
+    mt19937_64 eng;
+    explicit GenRng(uint64_t seed) : eng(seed) {}
+
+    double Uniform() { return (eng() >> 11) * 0x1.0p-53; } // [0, 1)
+    int Below(int n) { return (int)(Uniform() * n); }
+    double Normal() {
+        double u = 1.0 - Uniform();
+        return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * Uniform());
+    }
+};
+
+static const char* kCategoryNames[] = {
+    "Food", "Tech", "Apparel", "Books", "Games", "Crafts", "Coffee", "Bakery",
+};
+
+static string CategoryName(int k) {
+    const int named = sizeof(kCategoryNames) / sizeof(kCategoryNames[0]);
+    return k < named ? kCategoryNames[k] : "Cat" + to_string(k);
+}
+
+static double DrawValue(GenRng& rng, ValueDist dist) {
+    double v = 0.0;
+    switch (dist) {
+    case ValueDist::Uniform: v = 10.0 + 40.0 * rng.Uniform(); break;
+    case ValueDist::Normal: v = max(1.0, 30.0 + 8.0 * rng.Normal()); break;
+    case ValueDist::Heavy: v = min(1000.0, 10.0 * pow(1.0 - rng.Uniform(), -1.0 / 1.5)); break;
+    }
+    return round(v * 10.0) / 10.0;
+}
+
+static double BonusAt(GenRng& rng, BonusPattern pattern, int r, int c, int rows, int cols) {
+    double b = 0.0;
+    switch (pattern) {
+    case BonusPattern::Center: {
+        double dr = rows > 1 ? fabs(r - (rows - 1) / 2.0) / ((rows - 1) / 2.0) : 0.0;
+        double dc = cols > 1 ? fabs(c - (cols - 1) / 2.0) / ((cols - 1) / 2.0) : 0.0;
+        b = 1.0 - 0.35 * (dr + dc);
+        break;
+    }
+    case BonusPattern::Entrance:
+        b = 1.0 - 0.7 * (rows > 1 ? (double)r / (rows - 1) : 0.0);
+        break;
+    case BonusPattern::Aisles:
+        b = (r % 2 == 0 ? 0.9 : 0.5) + 0.1 * rng.Uniform();
+        break;
+    case BonusPattern::Random:
+        b = 0.3 + 0.7 * rng.Uniform();
+        break;
+    }
+    return round(b * 100.0) / 100.0;
+}
+
+Instance GenerateInstance(const GenParams& g, const Params& params) {
+    GenRng rng(g.seed);
+    Instance inst;
+    inst.params = params;
+    inst.params.rows = g.rows;
+    inst.params.cols = g.cols;
+
+    inst.slots.resize((size_t)g.rows * g.cols);
+    int free_slots = 0;
+    for (int r = 0; r < g.rows; r++) {
+        for (int c = 0; c < g.cols; c++) {
+            Slot& s = inst.slots[inst.index(r, c)];
+            s.r = r;
+            s.c = c;
+            s.bonus = BonusAt(rng, g.bonus, r, c, g.rows, g.cols);
+            s.blocked = rng.Uniform() < g.blocked;
+            if (!s.blocked) free_slots++;
+        }
+    }
+
+    int num_booths = (int)(min(1.0, max(0.0, g.fill)) * free_slots);
+    int categories = max(1, g.categories);
+    inst.booths.resize(num_booths);
+    for (int i = 0; i < num_booths; i++) {
+        inst.booths[i].id = i;
+        inst.booths[i].category = CategoryName(rng.Below(categories));
+        inst.booths[i].value = DrawValue(rng, g.values);
+    }
+    CompileInstance(inst);
+    return inst;
+}
+
+bool ParseValueDist(const string& name, ValueDist& out) {
+    if (name == "uniform") out = ValueDist::Uniform;
+    else if (name == "normal") out = ValueDist::Normal;
+    else if (name == "heavy") out = ValueDist::Heavy;
+    else return false;
+    return true;
+}
+
+bool ParseBonusPattern(const string& name, BonusPattern& out) {
+    if (name == "center") out = BonusPattern::Center;
+    else if (name == "entrance") out = BonusPattern::Entrance;
+    else if (name == "aisles") out = BonusPattern::Aisles;
+    else if (name == "random") out = BonusPattern::Random;
+    else return false;
+    return true;
+}
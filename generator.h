@@ -0,0 +1,43 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "model.h"
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// How booth values are drawn
+enum class ValueDist {
+    Uniform, // 10..50
+    Normal,  // mean 30, sd 8, at least 1
+    Heavy,   // Pareto tail: a few booths are worth much more
+};
+
+// How position bonuses are laid out over the grid
+enum class BonusPattern {
+    Center,   // highest in the middle, like the hand-written instances
+    Entrance, // highest at row 0, fading towards the back
+    Aisles,   // every other row faces a main aisle
+    Random,   // independent per slot
+};
+
+// Parameters of a synthetic instance
+struct GenParams {
+    int rows = 10, cols = 10;
+    double fill = 0.8;     // booths per free slot
+    int categories = 4;
+    ValueDist values = ValueDist::Uniform;
+    double blocked = 0.05; // chance of each slot being blocked
+    BonusPattern bonus = BonusPattern::Center;
+    uint64_t seed = 1;
+};
+
+// Build a random instance; the same parameters always give the same instance
+Instance GenerateInstance(const GenParams& g, const Params& params);
+
+// Parse the names used on the command line ("uniform", "center", ...)
+bool ParseValueDist(const string& name, ValueDist& out);
+bool ParseBonusPattern(const string& name, BonusPattern& out);
+
+#endif
@@ -1,7 +1,11 @@
 #include "greedy.h"
 #include "score.h"
+#include "neighborhood.h"
 #include <algorithm>
+#include <cstdint>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace std;
 
@@ -26,12 +30,55 @@ static bool CompareBooths(const Booth& a, const Booth& b,
     return count_a < count_b;
 }
 
+// Free slot where the booth adds the most score, -1 if none is allowed
+static int BestSlot(const Layout& L, int booth_id) {
+    int best_slot = -1;
+    double best_delta = -1e9;
+
+    // Try all feasible slots
+    for (size_t slot_idx = 0; slot_idx < L.inst.slots.size(); slot_idx++) {
+        const Slot& s = L.inst.slots[slot_idx];
+        if (s.blocked || s.booth_id >= 0) continue; // not feasible
+        if (!L.inst.Allowed(booth_id, slot_idx)) continue;
+
+        // score contribution of the booth at this slot
+        double contribution = PlacementGain(L, booth_id, slot_idx);
+
+        // Check if this is the best so far
+        bool is_better = false;
+        if (contribution > best_delta) {
+            is_better = true;
+        } else if (contribution == best_delta && best_slot >= 0) {
+            // tie-break by bonus, then by (r, c)
+            if (s.bonus > L.inst.slots[best_slot].bonus) {
+                is_better = true;
+            } else if (s.bonus == L.inst.slots[best_slot].bonus) {
+                if (s.r < L.inst.slots[best_slot].r ||
+                    (s.r == L.inst.slots[best_slot].r && s.c < L.inst.slots[best_slot].c)) {
+                    is_better = true;
+                }
+            }
+        }
+
+        if (is_better) {
+            best_delta = contribution;
+            best_slot = slot_idx;
+        }
+    }
+    return best_slot;
+}
+
 void GreedySeed(Layout& L) {
-    // sort booths by value, then rarity
+    EnsureCompiled(L.inst);
+    // sort the unplaced booths by value, then rarity
     auto cat_counts = CountCategories(L.inst.booths);
+    vector<bool> placed(L.inst.booths.size(), false);
+    for (const auto& s : L.inst.slots) {
+        if (s.booth_id >= 0) placed[s.booth_id] = true;
+    }
     vector<int> order;
     for (size_t i = 0; i < L.inst.booths.size(); i++) {
-        order.push_back(i);
+        if (!placed[i]) order.push_back(i);
     }
     sort(order.begin(), order.end(), [&](int i, int j) {
         return CompareBooths(L.inst.booths[i], L.inst.booths[j], cat_counts);
@@ -39,94 +86,7 @@ void GreedySeed(Layout& L) {
 
     // now place them greedily
     for (int booth_id : order) {
-        int best_slot = -1;
-        double best_delta = -1e9;
-
-        // Try all feasible slots
-        for (size_t slot_idx = 0; slot_idx < L.inst.slots.size(); slot_idx++) {
-            const Slot& s = L.inst.slots[slot_idx];
-            if (s.blocked || s.booth_id >= 0) continue; // not feasible
-
-            // Temporarily place booth
-            L.inst.slots[slot_idx].booth_id = booth_id;
-
-            // Compute delta score
-            double delta = DeltaMoveRelocate(L, booth_id, slot_idx);
-
-            // For greedy, we actually want the score contribution, not delta
-            // Since the booth is not placed yet, we compute its contribution
-            double exposure_gain = L.inst.booths[booth_id].value * s.bonus;
-
-            // Count clashes this placement would create
-            int row_clash = 0;
-            int across_clash = 0;
-            int r = s.r;
-            int c = s.c;
-            string cat = L.inst.booths[booth_id].category;
-
-            // left
-            if (c > 0) {
-                int left = L.inst.index(r, c - 1);
-                int left_bid = L.inst.slots[left].booth_id;
-                if (left_bid >= 0 && L.inst.booths[left_bid].category == cat) {
-                    row_clash++;
-                }
-            }
-            // right
-            if (c < L.inst.params.cols - 1) {
-                int right = L.inst.index(r, c + 1);
-                int right_bid = L.inst.slots[right].booth_id;
-                if (right_bid >= 0 && L.inst.booths[right_bid].category == cat) {
-                    row_clash++;
-                }
-            }
-            // above
-            if (r > 0) {
-                int above = L.inst.index(r - 1, c);
-                int above_bid = L.inst.slots[above].booth_id;
-                if (above_bid >= 0 && L.inst.booths[above_bid].category == cat) {
-                    across_clash++;
-                }
-            }
-            // below
-            if (r < L.inst.params.rows - 1) {
-                int below = L.inst.index(r + 1, c);
-                int below_bid = L.inst.slots[below].booth_id;
-                if (below_bid >= 0 && L.inst.booths[below_bid].category == cat) {
-                    across_clash++;
-                }
-            }
-
-            double contribution = exposure_gain
-                                - L.inst.params.wC * row_clash
-                                - L.inst.params.wX * across_clash;
-
-            // Remove temporary placement
-            L.inst.slots[slot_idx].booth_id = -1;
-
-            // Check if this is the best so far
-            bool is_better = false;
-            if (contribution > best_delta) {
-                is_better = true;
-            } else if (contribution == best_delta && best_slot >= 0) {
-                // tie-break by bonus, then by (r, c)
-                if (s.bonus > L.inst.slots[best_slot].bonus) {
-                    is_better = true;
-                } else if (s.bonus == L.inst.slots[best_slot].bonus) {
-                    if (s.r < L.inst.slots[best_slot].r ||
-                        (s.r == L.inst.slots[best_slot].r && s.c < L.inst.slots[best_slot].c)) {
-                        is_better = true;
-                    }
-                }
-            }
-
-            if (is_better) {
-                best_delta = contribution;
-                best_slot = slot_idx;
-            }
-        }
-
-        // Place the booth in the best slot found
+        int best_slot = BestSlot(L, booth_id);
         if (best_slot >= 0) {
             L.inst.slots[best_slot].booth_id = booth_id;
         }
@@ -134,6 +94,7 @@ void GreedySeed(Layout& L) {
 }
 
 void GreedyValueOnly(Layout& L) {
+    EnsureCompiled(L.inst);
     // Sort booths by value only
     vector<int> order;
     for (size_t i = 0; i < L.inst.booths.size(); i++) {
@@ -151,6 +112,7 @@ void GreedyValueOnly(Layout& L) {
         for (size_t slot_idx = 0; slot_idx < L.inst.slots.size(); slot_idx++) {
             const Slot& s = L.inst.slots[slot_idx];
             if (s.blocked || s.booth_id >= 0) continue;
+            if (!L.inst.Allowed(booth_id, slot_idx)) continue;
 
             double exposure = L.inst.booths[booth_id].value * s.bonus;
             if (exposure > best_exposure) {
@@ -164,3 +126,187 @@ void GreedyValueOnly(Layout& L) {
         }
     }
 }
+
+// First-fit coloring of the open slots in row-major order: each slot takes
+// the smallest color that none of its already colored neighbors has. This
+// gives a checkerboard for the four-neighborhood and four colors for the
+// diagonal one. Blocked slots get -1. Returns the number of colors.
+template <typename N>
+static int ColorSlots(const Instance& inst, vector<int>& color) {
+    color.assign(inst.slots.size(), -1);
+    int colors = 0;
+    for (size_t i = 0; i < inst.slots.size(); i++) {
+        const Slot& s = inst.slots[i];
+        if (s.blocked) continue;
+        uint64_t used = 0;
+        ForEachNeighbor<N>(inst.params, s.r, s.c, [&](int nb, const Offset&) {
+            if (color[nb] >= 0) used |= 1ull << color[nb];
+        });
+        int k = 0;
+        while ((used >> k) & 1) k++;
+        color[i] = k;
+        colors = max(colors, k + 1);
+    }
+    return colors;
+}
+
+void ColoredSeed(Layout& L) {
+    Instance& inst = L.inst;
+    EnsureCompiled(inst);
+    vector<int> color;
+    int colors = WithNeighborhood(inst.params.neighborhood, [&](auto policy) {
+        return ColorSlots<decltype(policy)>(inst, color);
+    });
+    if (colors == 0) return;
+
+    // unplaced booths per category id, and empty slots per color class
+    int n = inst.num_cat_ids;
+    vector<bool> placed(inst.booths.size(), false);
+    vector<vector<int>> class_slots(colors);
+    for (size_t i = 0; i < inst.slots.size(); i++) {
+        const Slot& s = inst.slots[i];
+        if (s.booth_id >= 0) {
+            placed[s.booth_id] = true;
+        } else if (!s.blocked) {
+            class_slots[color[i]].push_back(i);
+        }
+    }
+    vector<int> order;
+    vector<int> need(n, 0);
+    for (size_t b = 0; b < inst.booths.size(); b++) {
+        if (placed[b]) continue;
+        order.push_back(b);
+        need[inst.booth_cat[b + 1]]++;
+    }
+    vector<long> room(colors);
+    for (int k = 0; k < colors; k++) room[k] = class_slots[k].size();
+
+    // Biggest categories first: each goes to the class that already holds
+    // the categories it conflicts with most (they never touch there), then
+    // to the class with the most room. A category is split over classes
+    // only when no class has room for all of it.
+    vector<int> cats;
+    for (int c = 1; c < n; c++) {
+        if (need[c] > 0) cats.push_back(c);
+    }
+    stable_sort(cats.begin(), cats.end(), [&](int a, int b) { return need[a] > need[b]; });
+
+    // the categories each one has a nonzero weight with: itself, unless
+    // that is set to 0, and its declared pairs
+    vector<vector<pair<int, double>>> partners(n);
+    for (int c : cats) {
+        double w = inst.Conflict(c, c);
+        if (w != 0.0) partners[c].push_back({c, w});
+    }
+    unordered_map<string, int> ids;
+    for (int k = 1; k < n; k++) ids.emplace(inst.categories[k - 1], k);
+    unordered_set<uint64_t> seen;
+    for (const auto& cc : inst.conflicts) {
+        int a = ids[cc.a], b = ids[cc.b];
+        if (a == b || !seen.insert(Instance::ConflictKey(a, b)).second) continue;
+        double w = inst.Conflict(a, b); // the last declaration of the pair
+        if (w == 0.0) continue;
+        partners[a].push_back({b, w});
+        partners[b].push_back({a, w});
+    }
+
+    // affinity[k * n + y] = sum of quota[k][x] * weight(x, y): how much a
+    // booth of category y conflicts with what class k holds. It is updated
+    // once per quota change, so choosing a class is O(colors).
+    vector<vector<int>> quota(colors, vector<int>(n, 0));
+    vector<double> affinity((size_t)colors * n, 0.0);
+    for (int c : cats) {
+        int left = need[c];
+        while (left > 0) {
+            int best = -1;
+            bool best_fits = false;
+            double best_affinity = 0.0;
+            for (int k = 0; k < colors; k++) {
+                if (room[k] == 0) continue;
+                bool fits = room[k] >= left;
+                double affinity_k = affinity[(size_t)k * n + c];
+                bool better = best < 0 || (fits && !best_fits) ||
+                              (fits == best_fits &&
+                               (affinity_k > best_affinity ||
+                                (affinity_k == best_affinity && room[k] > room[best])));
+                if (better) {
+                    best = k;
+                    best_fits = fits;
+                    best_affinity = affinity_k;
+                }
+            }
+            if (best < 0) break; // more booths than slots
+            int take = min<long>(left, room[best]);
+            quota[best][c] += take;
+            for (const auto& [y, w] : partners[c]) affinity[(size_t)best * n + y] += take * w;
+            room[best] -= take;
+            left -= take;
+        }
+    }
+
+    // Booths by value (then rarity) into the best free slot of their
+    // class; slot indices are row-major, so ties go to the lowest (r, c)
+    for (auto& list : class_slots) {
+        stable_sort(list.begin(), list.end(), [&](int a, int b) {
+            return inst.slots[a].bonus > inst.slots[b].bonus;
+        });
+    }
+    // same order as GreedySeed, with the rarity looked up by category id
+    vector<int> cat_count(n, 0);
+    for (size_t b = 0; b < inst.booths.size(); b++) cat_count[inst.booth_cat[b + 1]]++;
+    stable_sort(order.begin(), order.end(), [&](int i, int j) {
+        double vi = inst.booths[i].value, vj = inst.booths[j].value;
+        if (vi != vj) return vi > vj;
+        return cat_count[inst.booth_cat[i + 1]] < cat_count[inst.booth_cat[j + 1]];
+    });
+
+    vector<size_t> next(colors, 0); // first possibly free slot of each class
+    for (int booth_id : order) {
+        int cat = inst.booth_cat[booth_id + 1];
+        int best_class = -1, best_slot = -1;
+        for (int k = 0; k < colors; k++) {
+            if (quota[k][cat] == 0) continue;
+            const vector<int>& list = class_slots[k];
+            while (next[k] < list.size() && inst.slots[list[next[k]]].booth_id >= 0) next[k]++;
+            // a booth under placement rules looks further down its class
+            int slot = -1;
+            for (size_t j = next[k]; j < list.size(); j++) {
+                if (inst.slots[list[j]].booth_id < 0 && inst.Allowed(booth_id, list[j])) {
+                    slot = list[j];
+                    break;
+                }
+            }
+            if (slot >= 0 && (best_slot < 0 || inst.slots[slot].bonus > inst.slots[best_slot].bonus)) {
+                best_class = k;
+                best_slot = slot;
+            }
+        }
+        if (best_slot >= 0) {
+            quota[best_class][cat]--;
+        } else {
+            best_slot = BestSlot(L, booth_id);
+        }
+        if (best_slot >= 0) {
+            inst.slots[best_slot].booth_id = booth_id;
+        }
+    }
+}
+
+void SeedLayout(Layout& L) {
+    if (L.inst.params.construction == Construction::Colored) {
+        ColoredSeed(L);
+    } else {
+        GreedySeed(L);
+    }
+}
+
+bool ParseConstruction(const string& name, Construction& out) {
+    if (name == "greedy") {
+        out = Construction::Greedy;
+    } else if (name == "colored") {
+        out = Construction::Colored;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -3,10 +3,28 @@
 
 #include "model.h"
 
-// Greedy seeding algorithm: place booths one by one in best positions
+// Greedy seeding algorithm: place booths one by one in best positions.
+// Booths that are already placed keep their slot.
 void GreedySeed(Layout& L);
 
 // Baseline: value-only greedy (ignores clashes)
 void GreedyValueOnly(Layout& L);
 
+// Category-aware seeding in near-linear time. The free slots are colored
+// so that no two neighbors (under the instance's neighborhood) share a
+// color, e.g. a checkerboard for the four-neighborhood. Each category goes
+// to the color class where its conflicting categories already are, split
+// over classes only when it does not fit, so booths of one class never
+// neighbor each other. Booths are then placed by value into the best
+// remaining slots of their class. Booths that are already placed keep
+// their slot; placement rules are respected, and a booth with no allowed
+// slot left in its class falls back to the GreedySeed choice.
+void ColoredSeed(Layout& L);
+
+// Seed with the construction chosen in L.inst.params
+void SeedLayout(Layout& L);
+
+// Parse a construction name: greedy or colored
+bool ParseConstruction(const string& name, Construction& out);
+
 #endif
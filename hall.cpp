@@ -0,0 +1,254 @@
+#include "hall.h"
+#include "greedy.h"
+#include "localsearch.h"
+#include "io.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// One hall during the solve. Booths that belong to another hall get an
+// all-zero placement mask here, so greedy and local search leave them out.
+struct HallState {
+    Layout L;
+    vector<int> rule_mask;  // booth_mask from the hall's own rules
+    int nowhere = -1;       // mask with no slot allowed
+
+    void SetOwned(int booth_id, bool owned) {
+        L.inst.booth_mask[booth_id] = owned ? rule_mask[booth_id] : nowhere;
+    }
+
+    // placement rules only, whoever owns the booth
+    bool RuleAllows(int booth_id, int slot_idx) const {
+        return L.inst.MaskAllows(rule_mask[booth_id], slot_idx);
+    }
+};
+
+static void InitHall(HallState& h, const Instance& inst) {
+    h.L.inst = inst;
+    Instance& in = h.L.inst;
+    EnsureCompiled(in);
+    h.rule_mask = in.booth_mask;
+    h.nowhere = in.allowed.size() / in.mask_words;
+    in.allowed.resize(in.allowed.size() + in.mask_words, 0);
+}
+
+// Give each booth, most valuable first, to the hall with the most free
+// slots left among the halls its rules let it into
+static vector<int> SplitBooths(vector<HallState>& halls) {
+    int num_halls = halls.size();
+    int num_booths = halls[0].L.inst.booths.size();
+    vector<int> free_slots(num_halls, 0);
+    vector<vector<int>> mask_fits(num_halls); // per rule mask: -1 unknown, 0/1
+    for (int h = 0; h < num_halls; h++) {
+        for (const auto& s : halls[h].L.inst.slots) {
+            if (!s.blocked) free_slots[h]++;
+        }
+        mask_fits[h].assign(halls[h].nowhere, -1);
+    }
+
+    // true if the mask allows at least one open slot of the hall
+    auto fits = [&](int h, int m) {
+        if (m < 0) return true;
+        if (mask_fits[h][m] < 0) {
+            const Instance& in = halls[h].L.inst;
+            mask_fits[h][m] = 0;
+            for (size_t i = 0; i < in.slots.size(); i++) {
+                if (!in.slots[i].blocked && in.MaskAllows(m, i)) {
+                    mask_fits[h][m] = 1;
+                    break;
+                }
+            }
+        }
+        return mask_fits[h][m] == 1;
+    };
+
+    const vector<Booth>& booths = halls[0].L.inst.booths;
+    vector<int> order(num_booths);
+    for (int b = 0; b < num_booths; b++) order[b] = b;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return booths[a].value > booths[b].value;
+    });
+
+    vector<int> owner(num_booths, -1);
+    for (int b : order) {
+        int best = -1;
+        for (int h = 0; h < num_halls; h++) {
+            if (free_slots[h] == 0 || !fits(h, halls[h].rule_mask[b])) continue;
+            if (best < 0 || free_slots[h] > free_slots[best]) best = h;
+        }
+        owner[b] = best;
+        if (best >= 0) free_slots[best]--;
+    }
+    return owner;
+}
+
+// One coordinator pass: every booth looks for its best move into another
+// hall, either into an empty slot or by swapping with a booth there, and
+// takes it if the combined score goes up. Returns the number of moves.
+static int ExchangePass(vector<HallState>& halls, vector<int>& owner, Rng& rng) {
+    int num_halls = halls.size();
+    int num_booths = owner.size();
+
+    vector<int> slot_of(num_booths, -1);
+    vector<vector<int>> empties(num_halls);
+    for (int h = 0; h < num_halls; h++) {
+        const auto& slots = halls[h].L.inst.slots;
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].booth_id >= 0) {
+                slot_of[slots[i].booth_id] = i;
+            } else if (!slots[i].blocked) {
+                empties[h].push_back(i);
+            }
+        }
+        // sample empty slots like LocalSearch does
+        SampleFront(empties[h], 30, rng);
+        if (empties[h].size() > 30) empties[h].resize(30);
+    }
+
+    const double kMinGain = 1e-9; // ignore rounding noise, so moves never cycle
+    int moves = 0;
+    for (int b = 0; b < num_booths; b++) {
+        int a = owner[b];
+        if (a < 0) continue;
+        int sa = slot_of[b];
+        Layout& LA = halls[a].L;
+        double keep = sa >= 0 ? PlacementGain(LA, b, sa) : 0.0;
+
+        double best_delta = kMinGain;
+        int best_hall = -1, best_slot = -1;
+        for (int hb = 0; hb < num_halls; hb++) {
+            if (hb == a) continue;
+            HallState& B = halls[hb];
+            for (int t : empties[hb]) {
+                if (B.L.inst.slots[t].booth_id >= 0 || !B.RuleAllows(b, t)) continue;
+                double delta = PlacementGain(B.L, b, t) - keep;
+                if (delta > best_delta) {
+                    best_delta = delta;
+                    best_hall = hb;
+                    best_slot = t;
+                }
+            }
+            if (sa < 0) continue; // nothing to swap back
+            const auto& slots = B.L.inst.slots;
+            for (size_t sb = 0; sb < slots.size(); sb++) {
+                int y = slots[sb].booth_id;
+                if (y < 0 || !halls[a].RuleAllows(y, sa) || !B.RuleAllows(b, sb)) continue;
+                double delta = PlacementGain(LA, y, sa) - keep +
+                               PlacementGain(B.L, b, sb) - PlacementGain(B.L, y, sb);
+                if (delta > best_delta) {
+                    best_delta = delta;
+                    best_hall = hb;
+                    best_slot = sb;
+                }
+            }
+        }
+        if (best_hall < 0) continue;
+
+        // move b over, and the booth it displaces (if any) back into sa
+        HallState& B = halls[best_hall];
+        int y = B.L.inst.slots[best_slot].booth_id;
+        if (sa >= 0) LA.inst.slots[sa].booth_id = y;
+        B.L.inst.slots[best_slot].booth_id = b;
+        halls[a].SetOwned(b, false);
+        B.SetOwned(b, true);
+        owner[b] = best_hall;
+        slot_of[b] = best_slot;
+        if (y >= 0) {
+            B.SetOwned(y, false);
+            halls[a].SetOwned(y, true);
+            owner[y] = a;
+            slot_of[y] = sa;
+        }
+        moves++;
+    }
+    return moves;
+}
+
+EventResult SolveEvent(const Event& event, int max_iters, unsigned seed, int rounds) {
+    int num_halls = event.halls.size();
+    vector<HallState> halls(num_halls);
+    for (int h = 0; h < num_halls; h++) InitHall(halls[h], event.halls[h]);
+
+    vector<int> owner = SplitBooths(halls);
+    for (int h = 0; h < num_halls; h++) {
+        for (size_t b = 0; b < owner.size(); b++) halls[h].SetOwned(b, owner[b] == h);
+    }
+
+    EventResult result;
+    result.stats.resize(num_halls);
+    if (rounds < 1) rounds = 1;
+    int iters = max(1, max_iters / rounds);
+    // stream 0 is the coordinator's; hall h in round r uses 1 + r * halls + h
+    Rng rng(seed, 0);
+    for (int round = 0; round < rounds; round++) {
+        // every hall searches on its own thread; the coordinator waits
+        vector<thread> pool;
+        for (int h = 0; h < num_halls; h++) {
+            pool.emplace_back([&, h, round] {
+                if (round == 0) {
+                    STATS_PHASE(greedy);
+                    SeedLayout(halls[h].L);
+                }
+                Rng hall_rng(seed, 1 + (uint64_t)round * num_halls + h);
+                {
+                    STATS_PHASE(local_search);
+                    LocalSearch(halls[h].L, iters, hall_rng);
+                }
+                // a fresh thread every round, so its stats are this round's
+                AddStats(result.stats[h], ThreadStats());
+            });
+        }
+        for (auto& th : pool) th.join();
+        result.rounds++;
+
+        int moved = ExchangePass(halls, owner, rng);
+        result.exchanges += moved;
+        if (moved == 0) break;
+    }
+
+    vector<bool> placed(owner.size(), false);
+    for (auto& h : halls) {
+        // drop the ownership masks: the layouts leave with their own rules
+        Instance& in = h.L.inst;
+        in.booth_mask = h.rule_mask;
+        in.allowed.resize((size_t)h.nowhere * in.mask_words);
+        for (const auto& s : in.slots) {
+            if (s.booth_id >= 0) placed[s.booth_id] = true;
+        }
+
+        ScoreParts parts = ComputeScoreParts(h.L);
+        result.score += parts.Score(h.L.inst.params.wC, h.L.inst.params.wX);
+        result.parts.push_back(parts);
+        result.halls.push_back(move(h.L));
+    }
+    for (size_t b = 0; b < placed.size(); b++) {
+        if (!placed[b]) result.unplaced.push_back(b);
+    }
+    return result;
+}
+
+void PrintEvent(const EventResult& result) {
+    for (size_t h = 0; h < result.halls.size(); h++) {
+        const Layout& L = result.halls[h];
+        const ScoreParts& p = result.parts[h];
+        int placed = 0;
+        for (const auto& s : L.inst.slots) {
+            if (s.booth_id >= 0) placed++;
+        }
+        cout << "\nHall " << h << ": " << placed << " booths, score "
+             << p.Score(L.inst.params.wC, L.inst.params.wX) << " (exposure " << p.exposure
+             << ", row clashes " << p.row_clash << ", across clashes " << p.across_clash
+             << ")" << endl;
+        PrintLayout(L);
+    }
+    cout << "\nCombined Score: " << result.score << endl;
+    cout << "Cross-hall exchanges: " << result.exchanges << " in " << result.rounds
+         << " rounds" << endl;
+    if (!result.unplaced.empty()) {
+        cout << "Unplaced booths (no hall has room or allows them):";
+        for (int b : result.unplaced) cout << " " << b;
+        cout << endl;
+    }
+}
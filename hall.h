@@ -0,0 +1,33 @@
+#ifndef HALL_H
+#define HALL_H
+
+#include "model.h"
+#include "score.h"
+#include "stats.h"
+#include <vector>
+
+using namespace std;
+
+// Solved multi-hall event
+struct EventResult {
+    vector<Layout> halls;
+    vector<ScoreParts> parts;  // per hall
+    vector<SolverStats> stats; // per hall, summed over the rounds (STATS=1)
+    double score = 0.0;        // sum of the hall scores
+    int exchanges = 0;         // cross-hall moves applied by the coordinator
+    int rounds = 0;            // rounds actually run
+    vector<int> unplaced;      // booths no hall could take, by id
+};
+
+// Split the booths between the halls, then alternate rounds in which every
+// hall runs LocalSearch on its own thread with a coordinator pass that
+// moves or swaps booths between halls when that raises the combined score.
+// Stops after `rounds` rounds or when a coordinator pass finds nothing.
+// Booths that end up in no hall (no room, or no hall their rules allow)
+// are listed in `unplaced`. The hall layouts keep their own rules only.
+EventResult SolveEvent(const Event& event, int max_iters, unsigned seed, int rounds);
+
+// Print per-hall scores and layouts and the combined score
+void PrintEvent(const EventResult& result);
+
+#endif
@@ -1,66 +1,143 @@
 #include "io.h"
+#include "binio.h"
+#include "output.h"
+#include <cctype>
+#include <charconv>
+#include <cstring>
 #include <fstream>
-#include <sstream>
 #include <iostream>
-#include <iomanip>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
-// Skip comment lines and empty lines
-static bool ReadLine(ifstream& in, string& line) {
-    while (getline(in, line)) {
-        // trim leading whitespace
-        size_t start = line.find_first_not_of(" \t\r\n");
-        if (start == string::npos) continue; // empty line
-        line = line.substr(start);
-        if (line[0] == '#') continue; // comment
-        return true;
+// Walks the text line by line without copying it. Blank lines and
+// comment lines are skipped; tokens are split on spaces and tabs.
+struct TextCursor {
+    const char* next;     // start of the next unread line
+    const char* end;      // end of the whole buffer
+    const char* line_start;
+    const char* line_end;
+    const char* p;        // next unread character of the current line
+    int line = 0;
+    ParseError* err;
+
+    TextCursor(const char* data, size_t size, ParseError* e)
+        : next(data), end(data + size), line_start(data), line_end(data),
+          p(data), err(e) {}
+
+    bool Fail(const char* at, const string& message) {
+        err->line = line;
+        err->col = (int)(at - line_start) + 1;
+        err->message = message;
+        return false;
     }
-    return false;
-}
 
-Instance ReadInstance(const string& filename, const Params& params) {
-    Instance inst;
-    inst.params = params;
+    // Move to the next line that has content
+    bool NextLine() {
+        while (next < end) {
+            const char* nl = (const char*)memchr(next, '\n', end - next);
+            line_start = next;
+            line_end = nl ? nl : end;
+            next = nl ? nl + 1 : end;
+            line++;
 
-    ifstream in(filename);
-    if (!in) {
-        cerr << "Error: cannot open " << filename << endl;
-        exit(1);
+            const char* first = line_start;
+            while (first < line_end && IsSpace(*first)) first++;
+            if (first < line_end && *first != '#') {
+                p = first;
+                return true;
+            }
+        }
+        // out of input: report errors just past the last line
+        line++;
+        line_start = line_end = p = end;
+        return false;
     }
 
-    string line;
+    static bool IsSpace(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r';
+    }
 
-    // Read rows and cols
-    if (!ReadLine(in, line)) {
-        cerr << "Error: missing rows/cols" << endl;
-        exit(1);
+    // Next token of the current line as [tok, tok_end)
+    bool Token(const char*& tok, const char*& tok_end) {
+        while (p < line_end && IsSpace(*p)) p++;
+        tok = p;
+        while (p < line_end && !IsSpace(*p)) p++;
+        tok_end = p;
+        return tok < tok_end;
     }
-    istringstream iss1(line);
-    iss1 >> inst.params.rows >> inst.params.cols;
 
-    // Read number of booths
-    if (!ReadLine(in, line)) {
-        cerr << "Error: missing booth count" << endl;
-        exit(1);
+    template <typename T>
+    bool Number(T& value, const char* what) {
+        const char *tok, *tok_end;
+        if (!Token(tok, tok_end)) return Fail(tok, string("missing ") + what);
+        // from_chars rejects a leading '+', which istringstream accepted;
+        // skip it only before a digit, so "+-5" stays an error
+        bool plus = *tok == '+' && tok + 1 < tok_end && isdigit((unsigned char)tok[1]);
+        const char* digits = tok + plus;
+        auto res = from_chars(digits, tok_end, value);
+        if (res.ec != errc() || res.ptr != tok_end) {
+            return Fail(tok, string("bad ") + what + " '" + string(tok, tok_end) + "'");
+        }
+        return true;
+    }
+
+    bool Word(string& value, const char* what) {
+        const char *tok, *tok_end;
+        if (!Token(tok, tok_end)) return Fail(tok, string("missing ") + what);
+        value.assign(tok, tok_end);
+        return true;
+    }
+
+    bool Line(const char* what) {
+        if (!NextLine()) return Fail(p, string("missing ") + what);
+        return true;
+    }
+};
+
+// Grid size on the current line
+static bool ParseGridSize(TextCursor& in, Params& p) {
+    if (!in.Line("rows/cols")) return false;
+    const char* at = in.p;
+    if (!in.Number(p.rows, "rows")) return false;
+    if (!in.Number(p.cols, "cols")) return false;
+    if (p.rows <= 0 || p.cols <= 0) {
+        return in.Fail(at, "grid must have at least one row and column");
     }
+    if ((long long)p.rows * p.cols > kMaxGridSlots) {
+        return in.Fail(at, "grid too large (more than " + to_string(kMaxGridSlots) +
+                               " slots)");
+    }
+    return true;
+}
+
+// Booth count and booth lines; count_line is where the count was
+static bool ParseBooths(TextCursor& in, vector<Booth>& booths, int& count_line) {
+    if (!in.Line("booth count")) return false;
+    const char* count_at = in.p;
+    count_line = in.line;
     int num_booths;
-    istringstream iss2(line);
-    iss2 >> num_booths;
+    if (!in.Number(num_booths, "booth count")) return false;
+    if (num_booths < 0) return in.Fail(count_at, "negative booth count");
 
-    // Read booths
-    inst.booths.resize(num_booths);
+    booths.resize(num_booths);
     for (int i = 0; i < num_booths; i++) {
-        if (!ReadLine(in, line)) {
-            cerr << "Error: missing booth data" << endl;
-            exit(1);
-        }
-        istringstream iss(line);
-        iss >> inst.booths[i].id >> inst.booths[i].category >> inst.booths[i].value;
+        Booth& b = booths[i];
+        if (!in.Line("booth data")) return false;
+        if (!in.Number(b.id, "booth id")) return false;
+        if (!in.Word(b.category, "booth category")) return false;
+        if (!in.Number(b.value, "booth value")) return false;
     }
+    return true;
+}
 
+// Blocked slots and position bonuses of a grid whose size is already set
+static bool ParseSlots(TextCursor& in, Instance& inst) {
     // Initialize slots
-    int total_slots = inst.params.rows * inst.params.cols;
+    size_t total_slots = (size_t)inst.params.rows * inst.params.cols;
     inst.slots.resize(total_slots);
     for (int r = 0; r < inst.params.rows; r++) {
         for (int c = 0; c < inst.params.cols; c++) {
@@ -72,90 +149,403 @@ Instance ReadInstance(const string& filename, const Params& params) {
     }
 
     // Read blocked slots
-    if (!ReadLine(in, line)) {
-        cerr << "Error: missing blocked count" << endl;
-        exit(1);
-    }
+    if (!in.Line("blocked count")) return false;
+    const char* count_at = in.p;
     int num_blocked;
-    istringstream iss3(line);
-    iss3 >> num_blocked;
-
+    if (!in.Number(num_blocked, "blocked count")) return false;
+    if (num_blocked < 0) return in.Fail(count_at, "negative blocked count");
     for (int i = 0; i < num_blocked; i++) {
-        if (!ReadLine(in, line)) {
-            cerr << "Error: missing blocked slot" << endl;
-            exit(1);
-        }
+        if (!in.Line("blocked slot")) return false;
+        const char* at = in.p;
         int r, c;
-        istringstream iss(line);
-        iss >> r >> c;
+        if (!in.Number(r, "blocked row")) return false;
+        if (!in.Number(c, "blocked column")) return false;
+        if (r < 0 || r >= inst.params.rows || c < 0 || c >= inst.params.cols) {
+            return in.Fail(at, "blocked slot outside the grid");
+        }
         inst.slots[inst.index(r, c)].blocked = true;
     }
 
     // Read position bonuses
     for (int r = 0; r < inst.params.rows; r++) {
-        if (!ReadLine(in, line)) {
-            cerr << "Error: missing bonus row " << r << endl;
-            exit(1);
-        }
-        istringstream iss(line);
+        if (!in.Line(("bonus row " + to_string(r)).c_str())) return false;
         for (int c = 0; c < inst.params.cols; c++) {
-            double bonus;
-            iss >> bonus;
-            inst.slots[inst.index(r, c)].bonus = bonus;
+            if (!in.Number(inst.slots[inst.index(r, c)].bonus, "bonus")) return false;
         }
     }
+    return true;
+}
+
+// Optional section count on the next line: count 0 (and true) at the end
+// of the input, false on a bad or negative count
+static bool ParseSectionCount(TextCursor& in, int& count, const char* what) {
+    count = 0;
+    if (!in.NextLine()) return true;
+    const char* at = in.p;
+    if (!in.Number(count, what)) return false;
+    if (count < 0) return in.Fail(at, string("negative ") + what);
+    return true;
+}
+
+// Optional category conflicts: count, then "category_a category_b weight"
+static bool ParseConflicts(TextCursor& in, vector<CategoryConflict>& conflicts) {
+    int num_conflicts;
+    if (!ParseSectionCount(in, num_conflicts, "conflict count")) return false;
+    conflicts.resize(num_conflicts);
+    for (auto& cc : conflicts) {
+        if (!in.Line("category conflict")) return false;
+        if (!in.Word(cc.a, "conflict category")) return false;
+        if (!in.Word(cc.b, "conflict category")) return false;
+        if (!in.Number(cc.weight, "conflict weight")) return false;
+    }
+    return true;
+}
+
+// One placement rule from the rest of the current line:
+// "booth <id>|category <name> allow|forbid r0 c0 r1 c1"
+static bool ParseRule(TextCursor& in, PlacementRule& rule, const Params& p,
+                      int num_booths) {
+    const char* rule_at = in.p;
+    string target, kind;
+    if (!in.Word(target, "rule target")) return false;
+    rule.booth_id = -1;
+    if (target == "booth") {
+        if (!in.Number(rule.booth_id, "rule booth id")) return false;
+        if (rule.booth_id < 0 || rule.booth_id >= num_booths) {
+            return in.Fail(rule_at, "rule for an unknown booth");
+        }
+    } else if (target == "category") {
+        if (!in.Word(rule.category, "rule category")) return false;
+    } else {
+        return in.Fail(rule_at, "rule target must be booth or category");
+    }
+    const char* kind_at = in.p;
+    if (!in.Word(kind, "allow or forbid")) return false;
+    if (kind != "allow" && kind != "forbid") {
+        return in.Fail(kind_at, "expected allow or forbid, got '" + kind + "'");
+    }
+    rule.allow = kind == "allow";
+    if (!in.Number(rule.r0, "rule row")) return false;
+    if (!in.Number(rule.c0, "rule column")) return false;
+    if (!in.Number(rule.r1, "rule row")) return false;
+    if (!in.Number(rule.c1, "rule column")) return false;
+    if (rule.r0 < 0 || rule.c0 < 0 || rule.r1 >= p.rows || rule.c1 >= p.cols ||
+        rule.r0 > rule.r1 || rule.c0 > rule.c1) {
+        return in.Fail(rule_at, "rule rectangle outside the grid");
+    }
+    return true;
+}
+
+bool ParseInstanceText(const char* data, size_t size, const Params& params,
+                       Instance& inst, ParseError& err) {
+    inst = Instance();
+    inst.params = params;
+    TextCursor in(data, size, &err);
+
+    if (!ParseGridSize(in, inst.params)) return false;
+    int count_line;
+    if (!ParseBooths(in, inst.booths, count_line)) return false;
+    if (!ParseSlots(in, inst)) return false;
+    if (!ParseConflicts(in, inst.conflicts)) return false;
+
+    // Optional placement rules: count, then one rule per line
+    int num_rules;
+    if (!ParseSectionCount(in, num_rules, "rule count")) return false;
+    inst.rules.resize(num_rules);
+    for (auto& rule : inst.rules) {
+        if (!in.Line("placement rule")) return false;
+        if (!ParseRule(in, rule, inst.params, inst.booths.size())) return false;
+    }
 
     // Check if we have enough free slots
     int free_slots = 0;
     for (const auto& s : inst.slots) {
         if (!s.blocked) free_slots++;
     }
-    if (free_slots < num_booths) {
-        cerr << "Error: not enough slots for all booths" << endl;
+    if (free_slots < (int)inst.booths.size()) {
+        err.line = count_line;
+        err.col = 1;
+        err.message = "not enough slots for all booths";
+        return false;
+    }
+
+    CompileInstance(inst);
+    return true;
+}
+
+bool ParseEventText(const char* data, size_t size, const Params& params,
+                    Event& event, ParseError& err) {
+    event = Event();
+    TextCursor in(data, size, &err);
+
+    if (!in.Line("halls line")) return false;
+    const char *tok, *tok_end;
+    if (!in.Token(tok, tok_end) || string(tok, tok_end) != "halls") {
+        return in.Fail(tok, "expected 'halls <count>'");
+    }
+    const char* halls_at = in.p;
+    int num_halls;
+    if (!in.Number(num_halls, "hall count")) return false;
+    if (num_halls <= 0) return in.Fail(halls_at, "an event needs at least one hall");
+
+    vector<Booth> booths;
+    int count_line;
+    if (!ParseBooths(in, booths, count_line)) return false;
+
+    event.halls.resize(num_halls);
+    int free_slots = 0;
+    for (auto& hall : event.halls) {
+        hall.params = params;
+        if (!ParseGridSize(in, hall.params)) return false;
+        if (!ParseSlots(in, hall)) return false;
+        hall.booths = booths;
+        for (const auto& s : hall.slots) {
+            if (!s.blocked) free_slots++;
+        }
+    }
+
+    vector<CategoryConflict> conflicts;
+    if (!ParseConflicts(in, conflicts)) return false;
+    for (auto& hall : event.halls) hall.conflicts = conflicts;
+
+    // Optional rules, each line "<hall> booth|category ..."
+    int num_rules;
+    if (!ParseSectionCount(in, num_rules, "rule count")) return false;
+    for (int i = 0; i < num_rules; i++) {
+        if (!in.Line("placement rule")) return false;
+        const char* at = in.p;
+        int h;
+        if (!in.Number(h, "rule hall")) return false;
+        if (h < 0 || h >= num_halls) return in.Fail(at, "rule for an unknown hall");
+        PlacementRule rule;
+        if (!ParseRule(in, rule, event.halls[h].params, booths.size())) return false;
+        event.halls[h].rules.push_back(rule);
+    }
+
+    // A booth or category with allow rules in some halls may only go into
+    // those halls, so it is forbidden everywhere in the others
+    auto limit_to_allowing_halls = [&](const PlacementRule& allow) {
+        for (auto& hall : event.halls) {
+            bool allows = false;
+            for (const auto& rule : hall.rules) {
+                allows |= rule.allow && rule.booth_id == allow.booth_id &&
+                          rule.category == allow.category;
+            }
+            if (!allows) {
+                hall.rules.push_back(PlacementRule{false, allow.booth_id, allow.category, 0, 0,
+                                                   hall.params.rows - 1, hall.params.cols - 1});
+            }
+        }
+    };
+    for (int h = 0; h < num_halls; h++) {
+        vector<PlacementRule> own = event.halls[h].rules;
+        for (const auto& rule : own) {
+            if (rule.allow) limit_to_allowing_halls(rule);
+        }
+    }
+
+    if (free_slots < (int)booths.size()) {
+        err.line = count_line;
+        err.col = 1;
+        err.message = "not enough slots for all booths";
+        return false;
+    }
+    for (auto& hall : event.halls) CompileInstance(hall);
+    return true;
+}
+
+bool IsEventFile(const string& filename) {
+    ifstream in(filename);
+    string word;
+    while (in >> word) {
+        if (word[0] != '#') return word == "halls";
+        getline(in, word); // skip the rest of the comment
+    }
+    return false;
+}
+
+bool ParseEvent(const string& filename, const Params& params, Event& event,
+                ParseError& err) {
+    ifstream in(filename, ios::binary);
+    if (!in) {
+        err = ParseError{0, 0, "cannot open " + filename};
+        return false;
+    }
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return ParseEventText(text.data(), text.size(), params, event, err);
+}
+
+Event ReadEvent(const string& filename, const Params& params) {
+    Event event;
+    ParseError err;
+    if (!ParseEvent(filename, params, event, err)) {
+        if (err.line > 0) {
+            cerr << "Error: " << filename << ":" << err.line << ":" << err.col
+                 << ": " << err.message << endl;
+        } else {
+            cerr << "Error: " << err.message << endl;
+        }
         exit(1);
     }
+    return event;
+}
 
+bool ParseInstance(const string& filename, const Params& params,
+                   Instance& inst, ParseError& err) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0) close(fd);
+        err = ParseError{0, 0, "cannot open " + filename};
+        return false;
+    }
+
+    size_t size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        return ParseInstanceText("", 0, params, inst, err);
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        err = ParseError{0, 0, "cannot map " + filename};
+        return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    bool ok;
+    if (IsBinaryInstance((const char*)data, size)) {
+        BinaryInstanceView view;
+        ok = ViewBinaryInstance((const char*)data, size, view, err);
+        if (ok) BinaryToInstance(view, params, inst);
+    } else {
+        ok = ParseInstanceText((const char*)data, size, params, inst, err);
+    }
+    munmap(data, size);
+    return ok;
+}
+
+Instance ReadInstance(const string& filename, const Params& params) {
+    Instance inst;
+    ParseError err;
+    if (!ParseInstance(filename, params, inst, err)) {
+        if (err.line > 0) {
+            cerr << "Error: " << filename << ":" << err.line << ":" << err.col
+                 << ": " << err.message << endl;
+        } else {
+            cerr << "Error: " << err.message << endl;
+        }
+        exit(1);
+    }
     return inst;
 }
 
-void WriteLayout(const string& filename, const Layout& layout) {
+// Shortest text that reads back as the same double
+static string FormatDouble(double v) {
+    char buf[32];
+    auto res = to_chars(buf, buf + sizeof(buf), v);
+    return string(buf, res.ptr);
+}
+
+bool WriteInstance(const string& filename, const Instance& inst) {
     ofstream out(filename);
     if (!out) {
         cerr << "Error: cannot write to " << filename << endl;
-        return;
+        return false;
+    }
+    out << "# rows cols\n" << inst.params.rows << " " << inst.params.cols << "\n";
+    out << "# number_of_booths\n" << inst.booths.size() << "\n";
+    out << "# booths: id category value\n";
+    for (const auto& b : inst.booths) {
+        out << b.id << " " << b.category << " " << FormatDouble(b.value) << "\n";
     }
 
-    for (int r = 0; r < layout.inst.params.rows; r++) {
-        for (int c = 0; c < layout.inst.params.cols; c++) {
-            int idx = layout.inst.index(r, c);
-            const Slot& s = layout.inst.slots[idx];
+    int num_blocked = 0;
+    for (const auto& s : inst.slots) {
+        if (s.blocked) num_blocked++;
+    }
+    out << "# number_of_blocked_slots\n" << num_blocked << "\n";
+    out << "# blocked slots: r c\n";
+    for (const auto& s : inst.slots) {
+        if (s.blocked) out << s.r << " " << s.c << "\n";
+    }
 
-            if (s.blocked) {
-                out << "X ";
-            } else if (s.booth_id == -1) {
-                out << ". ";
+    out << "# position bonuses\n";
+    for (int r = 0; r < inst.params.rows; r++) {
+        for (int c = 0; c < inst.params.cols; c++) {
+            out << (c ? " " : "") << FormatDouble(inst.slots[inst.index(r, c)].bonus);
+        }
+        out << "\n";
+    }
+
+    // the rules section comes after the conflicts, so write both if needed
+    if (!inst.conflicts.empty() || !inst.rules.empty()) {
+        out << "# category conflicts: category_a category_b weight\n";
+        out << inst.conflicts.size() << "\n";
+        for (const auto& cc : inst.conflicts) {
+            out << cc.a << " " << cc.b << " " << FormatDouble(cc.weight) << "\n";
+        }
+    }
+    if (!inst.rules.empty()) {
+        out << "# placement rules: booth <id>|category <name> allow|forbid r0 c0 r1 c1\n";
+        out << inst.rules.size() << "\n";
+        for (const auto& rule : inst.rules) {
+            if (rule.booth_id >= 0) {
+                out << "booth " << rule.booth_id;
             } else {
-                out << s.booth_id << " ";
+                out << "category " << rule.category;
             }
+            out << (rule.allow ? " allow " : " forbid ") << rule.r0 << " " << rule.c0
+                << " " << rule.r1 << " " << rule.c1 << "\n";
         }
-        out << "\n";
     }
+    return (bool)out;
 }
 
-void PrintLayout(const Layout& layout) {
-    for (int r = 0; r < layout.inst.params.rows; r++) {
-        for (int c = 0; c < layout.inst.params.cols; c++) {
-            int idx = layout.inst.index(r, c);
-            const Slot& s = layout.inst.slots[idx];
-
-            if (s.blocked) {
-                cout << "  X";
-            } else if (s.booth_id == -1) {
-                cout << "  .";
-            } else {
-                cout << setw(3) << s.booth_id;
+bool ReadLayout(const string& filename, Instance& inst, ParseError& err) {
+    ifstream in(filename);
+    if (!in) {
+        err = ParseError{0, 0, "cannot open " + filename};
+        return false;
+    }
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    TextCursor cur(text.data(), text.size(), &err);
+
+    vector<bool> seen(inst.booths.size(), false); // each booth once, as in binio
+    for (int r = 0; r < inst.params.rows; r++) {
+        if (!cur.Line("layout row")) return false;
+        for (int c = 0; c < inst.params.cols; c++) {
+            Slot& s = inst.slots[inst.index(r, c)];
+            const char *tok, *tok_end;
+            if (!cur.Token(tok, tok_end)) return cur.Fail(tok, "missing layout cell");
+            string cell(tok, tok_end);
+            if (cell == "X" || cell == ".") {
+                if ((cell == "X") != s.blocked) {
+                    return cur.Fail(tok, "blocked slots do not match the instance");
+                }
+                s.booth_id = -1;
+                continue;
+            }
+            int id;
+            auto res = from_chars(tok, tok_end, id);
+            if (res.ec != errc() || res.ptr != tok_end || id < 0 ||
+                id >= (int)inst.booths.size() || s.blocked) {
+                return cur.Fail(tok, "bad layout cell '" + cell + "'");
             }
+            if (seen[id]) return cur.Fail(tok, "booth " + cell + " placed twice");
+            seen[id] = true;
+            s.booth_id = id;
         }
-        cout << "\n";
     }
+    return true;
+}
+
+void WriteLayout(const string& filename, const Layout& layout) {
+    WriteLayoutFile(filename, layout, LayoutFormat::Grid);
+}
+
+void PrintLayout(const Layout& layout) {
+    // the grid goes out with one write, after what cout has buffered
+    cout << flush;
+    WriteAll(STDOUT_FILENO, FormatLayout(layout, LayoutFormat::Grid));
 }
@@ -6,12 +6,56 @@
 
 using namespace std;
 
-// Read an instance from a file
+// Where and why parsing an instance failed (line and col are 1-based)
+struct ParseError {
+    int line = 0;
+    int col = 0;
+    string message;
+};
+
+// Largest grid a text instance may declare (rows * cols); bigger headers
+// are reported as a parse error instead of failing the allocation
+const long long kMaxGridSlots = 100000000;
+
+// Parse an instance from text held in memory. Blank lines and lines
+// starting with '#' are skipped. Returns false and fills err on bad input.
+bool ParseInstanceText(const char* data, size_t size, const Params& params,
+                       Instance& inst, ParseError& err);
+
+// Memory-map a file and parse it with ParseInstanceText, or load it
+// directly if it is in the binary format (see binio.h)
+bool ParseInstance(const string& filename, const Params& params,
+                   Instance& inst, ParseError& err);
+
+// Read an instance from a file, exits with a message on errors
 Instance ReadInstance(const string& filename, const Params& params);
 
+// Parse a multi-hall event from text in memory. The format starts with
+// "halls <n>" and the booth list, followed by one grid (rows cols, blocked
+// slots, bonuses) per hall, then the optional conflicts and rules as in a
+// single instance, with each rule line starting with its hall index.
+bool ParseEventText(const char* data, size_t size, const Params& params,
+                    Event& event, ParseError& err);
+
+// true if the file is a multi-hall event (starts with "halls")
+bool IsEventFile(const string& filename);
+
+// Read a multi-hall event from a file with ParseEventText
+bool ParseEvent(const string& filename, const Params& params, Event& event,
+                ParseError& err);
+
+// Read a multi-hall event from a file, exits with a message on errors
+Event ReadEvent(const string& filename, const Params& params);
+
+// Write an instance in the text format (placements are not included)
+bool WriteInstance(const string& filename, const Instance& inst);
+
 // Write a layout grid to a file
 void WriteLayout(const string& filename, const Layout& layout);
 
+// Read a layout grid written by WriteLayout into the slots of inst
+bool ReadLayout(const string& filename, Instance& inst, ParseError& err);
+
 // Print layout to stdout
 void PrintLayout(const Layout& layout);
 
@@ -1,28 +1,61 @@
 #include "localsearch.h"
 #include "score.h"
-#include <random>
+#include "stats.h"
+#include "trace.h"
 #include <vector>
 #include <algorithm>
+#include <chrono>
 
 using namespace std;
 
-void LocalSearch(Layout& L, int max_iters, unsigned seed) {
-    mt19937 rng(seed);
+void LocalSearch(Layout& L, int max_iters, unsigned seed, double time_limit_ms) {
+    Rng rng(seed);
+    LocalSearch(L, max_iters, rng, time_limit_ms);
+}
+
+void LocalSearch(Layout& L, int max_iters, Rng& rng, double time_limit_ms) {
+    EnsureCompiled(L.inst);
     int no_improve_count = 0;
     int patience = 1000;  // stop if no improvement for this many iterations
+    auto start = chrono::steady_clock::now();
+
+    // counted locally and published once at the end to keep the loop cheap
+    long long swap_evals = 0, relocate_evals = 0;
+    long long swap_accepted = 0, relocate_accepted = 0;
+    long long rejected_iters = 0, last_improvement = -1;
+    bool patience_stop = false;
+    int iter = 0;
+
+    // progress trace: one point at the start and one per improvement
+    TraceRing* trace = ThreadTrace();
+    // the totals are kept up to date from the accepted moves, so tracing
+    // never rescans the grid inside the loop
+    double score = 0.0, row_clash = 0.0, across_clash = 0.0;
+    if (trace) {
+        ScoreParts parts = ComputeScoreParts(L);
+        score = parts.Score(L.inst.params.wC, L.inst.params.wX);
+        row_clash = parts.row_clash;
+        across_clash = parts.across_clash;
+        trace->Record(TracePoint{TraceNowMs(), 0, score, score,
+                                 row_clash, across_clash, -1});
+    }
+
+    for (; iter < max_iters; iter++) {
+        if (time_limit_ms > 0) {
+            chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+            if (elapsed.count() >= time_limit_ms) break;
+        }
 
-    for (int iter = 0; iter < max_iters; iter++) {
         double best_delta = 0.0;
         int best_move_type = -1; // 0 = swap, 1 = relocate
-        int best_booth_a = -1;
-        int best_booth_b = -1;
-        int best_slot = -1;
-
-        // Collect placed booths
-        vector<int> placed_booths;
-        for (const auto& s : L.inst.slots) {
-            if (s.booth_id >= 0) {
-                placed_booths.push_back(s.booth_id);
+        int best_slot_a = -1;
+        int best_slot_b = -1;
+
+        // Collect the slots holding a booth
+        vector<int> placed_slots;
+        for (size_t i = 0; i < L.inst.slots.size(); i++) {
+            if (L.inst.slots[i].booth_id >= 0) {
+                placed_slots.push_back(i);
             }
         }
 
@@ -35,61 +68,52 @@ void LocalSearch(Layout& L, int max_iters, unsigned seed) {
         }
 
         // Try swap moves (limit to same row or adjacent rows for speed)
-        for (size_t i = 0; i < placed_booths.size(); i++) {
-            int booth_a = placed_booths[i];
-            int pos_a = -1;
-            for (size_t k = 0; k < L.inst.slots.size(); k++) {
-                if (L.inst.slots[k].booth_id == booth_a) {
-                    pos_a = k;
-                    break;
-                }
-            }
-            if (pos_a < 0) continue;
-
+        for (size_t i = 0; i < placed_slots.size(); i++) {
+            int pos_a = placed_slots[i];
             int row_a = L.inst.slots[pos_a].r;
 
-            for (size_t j = i + 1; j < placed_booths.size(); j++) {
-                int booth_b = placed_booths[j];
-                int pos_b = -1;
-                for (size_t k = 0; k < L.inst.slots.size(); k++) {
-                    if (L.inst.slots[k].booth_id == booth_b) {
-                        pos_b = k;
-                        break;
-                    }
-                }
-                if (pos_b < 0) continue;
-
+            for (size_t j = i + 1; j < placed_slots.size(); j++) {
+                int pos_b = placed_slots[j];
                 int row_b = L.inst.slots[pos_b].r;
 
                 // Only consider swaps within same row or adjacent rows
-                if (abs(row_a - row_b) > 1) continue;
+                // (slots are in row order, so no later slot is closer)
+                if (row_b - row_a > 1) break;
+
+                // both booths must be allowed in their new slots
+                int booth_a = L.inst.slots[pos_a].booth_id;
+                int booth_b = L.inst.slots[pos_b].booth_id;
+                if (!L.inst.Allowed(booth_a, pos_b) || !L.inst.Allowed(booth_b, pos_a)) {
+                    continue;
+                }
 
-                double delta = DeltaMoveSwap(L, booth_a, booth_b);
+                double delta = DeltaSwapSlots(L, pos_a, pos_b);
+                swap_evals++;
                 if (delta > best_delta) {
                     best_delta = delta;
                     best_move_type = 0;
-                    best_booth_a = booth_a;
-                    best_booth_b = booth_b;
+                    best_slot_a = pos_a;
+                    best_slot_b = pos_b;
                 }
             }
         }
 
         // Try relocate moves (sample empty slots for speed)
         int num_empty_samples = min(30, (int)empty_slots.size());
-        vector<int> sampled_empties = empty_slots;
-        shuffle(sampled_empties.begin(), sampled_empties.end(), rng);
-        if (sampled_empties.size() > (size_t)num_empty_samples) {
-            sampled_empties.resize(num_empty_samples);
-        }
+        SampleFront(empty_slots, num_empty_samples, rng);
 
-        for (int booth_id : placed_booths) {
-            for (int slot_idx : sampled_empties) {
-                double delta = DeltaMoveRelocate(L, booth_id, slot_idx);
+        for (int from : placed_slots) {
+            int booth = L.inst.slots[from].booth_id;
+            for (int k = 0; k < num_empty_samples; k++) {
+                int slot_idx = empty_slots[k];
+                if (!L.inst.Allowed(booth, slot_idx)) continue;
+                double delta = DeltaRelocateSlots(L, from, slot_idx);
+                relocate_evals++;
                 if (delta > best_delta) {
                     best_delta = delta;
                     best_move_type = 1;
-                    best_booth_a = booth_id;
-                    best_slot = slot_idx;
+                    best_slot_a = from;
+                    best_slot_b = slot_idx;
                 }
             }
         }
@@ -97,37 +121,44 @@ void LocalSearch(Layout& L, int max_iters, unsigned seed) {
         // Apply best move if any improvement found
         if (best_delta > 0.0) {
             no_improve_count = 0;  // reset counter
+            last_improvement = iter;
+            Slot& a = L.inst.slots[best_slot_a];
+            Slot& b = L.inst.slots[best_slot_b];
             if (best_move_type == 0) {
-                // Swap
-                int pos_a = -1, pos_b = -1;
-                for (size_t i = 0; i < L.inst.slots.size(); i++) {
-                    if (L.inst.slots[i].booth_id == best_booth_a) pos_a = i;
-                    if (L.inst.slots[i].booth_id == best_booth_b) pos_b = i;
-                }
-                if (pos_a >= 0 && pos_b >= 0) {
-                    L.inst.slots[pos_a].booth_id = best_booth_b;
-                    L.inst.slots[pos_b].booth_id = best_booth_a;
-                }
-            } else if (best_move_type == 1) {
-                // Relocate
-                int pos_a = -1;
-                for (size_t i = 0; i < L.inst.slots.size(); i++) {
-                    if (L.inst.slots[i].booth_id == best_booth_a) {
-                        pos_a = i;
-                        break;
-                    }
-                }
-                if (pos_a >= 0) {
-                    L.inst.slots[pos_a].booth_id = -1;
-                    L.inst.slots[best_slot].booth_id = best_booth_a;
-                }
+                swap_accepted++;
+            } else {
+                relocate_accepted++;
+            }
+            ClashCounts change;
+            if (trace) change = MoveClashChange(L, best_slot_a, best_slot_b);
+            // a relocate is a swap with an empty slot
+            swap(a.booth_id, b.booth_id);
+            if (trace) {
+                // local search only accepts improvements, so best == current
+                score += best_delta;
+                row_clash += change.row;
+                across_clash += change.across;
+                trace->Record(TracePoint{TraceNowMs(), iter + 1, score, score,
+                                         row_clash, across_clash, best_move_type});
             }
         } else {
             // no improvement this iteration
             no_improve_count++;
+            rejected_iters++;
             if (no_improve_count >= patience) {
+                patience_stop = true;
+                iter++;
                 break;  // stop early
             }
         }
     }
+
+    STATS_ADD(iterations, iter);
+    STATS_ADD(swap_evals, swap_evals);
+    STATS_ADD(relocate_evals, relocate_evals);
+    STATS_ADD(swap_accepted, swap_accepted);
+    STATS_ADD(relocate_accepted, relocate_accepted);
+    STATS_ADD(rejected_iters, rejected_iters);
+    STATS_SET(last_improvement_iter, last_improvement);
+    STATS_SET(stopped_by_patience, patience_stop);
 }
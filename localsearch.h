@@ -2,8 +2,15 @@
 #define LOCALSEARCH_H
 
 #include "model.h"
+#include "rng.h"
 
-// Local search using swap and relocate moves
-void LocalSearch(Layout& L, int max_iters, unsigned seed);
+// Local search using swap and relocate moves.
+// Stops after max_iters iterations or, if time_limit_ms > 0, once that much
+// wall time has passed.
+void LocalSearch(Layout& L, int max_iters, unsigned seed, double time_limit_ms = 0);
+
+// Same, drawing from the caller's stream, e.g. Rng(seed, stream id) for one
+// of several searches that share a seed
+void LocalSearch(Layout& L, int max_iters, Rng& rng, double time_limit_ms = 0);
 
 #endif
@@ -3,57 +3,265 @@
 #include "score.h"
 #include "greedy.h"
 #include "localsearch.h"
+#include "sweep.h"
+#include "batch.h"
+#include "server.h"
+#include "binio.h"
+#include "stats.h"
+#include "trace.h"
+#include "hall.h"
+#include "output.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <random>
 #include <ctime>
+#include <filesystem>
+#include <thread>
 
 using namespace std;
 
+// <stem>.<tag><ext>, one file per hall of an event or per Pareto point of
+// a sweep; the extension still picks the format
+static string TaggedFileName(const string& filename, const string& tag) {
+    filesystem::path p(filename);
+    string name = p.stem().string() + "." + tag + p.extension().string();
+    return (p.parent_path() / name).string();
+}
+
 int main(int argc, char** argv) {
-    if (argc < 2) {
-        cerr << "Usage: ./layout <input_file> [seed]" << endl;
+    // split positional arguments from --options
+    vector<string> args;
+    bool sweep = false, stats = false;
+    string batch_path, out_dir = "batch_out", serve_path, save_bin, trace_file;
+    string output_file, format_name;
+    int workers = max(1u, thread::hardware_concurrency());
+    Neighborhood neighborhood = Neighborhood::Four;
+    Construction construction = Construction::Greedy;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--sweep") {
+            sweep = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--batch" && has_value) {
+            batch_path = argv[++i];
+        } else if (arg == "--serve" && has_value) {
+            serve_path = argv[++i];
+        } else if (arg == "--neighborhood" && has_value) {
+            if (!ParseNeighborhood(argv[++i], neighborhood)) {
+                cerr << "Unknown neighborhood: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--construct" && has_value) {
+            if (!ParseConstruction(argv[++i], construction)) {
+                cerr << "Unknown construction: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--trace" && has_value) {
+            trace_file = argv[++i];
+        } else if (arg == "--output" && has_value) {
+            output_file = argv[++i];
+        } else if (arg == "--format" && has_value) {
+            format_name = argv[++i];
+        } else if (arg == "--save-bin" && has_value) {
+            save_bin = argv[++i];
+        } else if (arg == "--out" && has_value) {
+            out_dir = argv[++i];
+        } else if (arg == "--workers" && has_value) {
+            workers = atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    // --output picks the format from its extension unless --format is given
+    LayoutFormat format = LayoutFormatFor(output_file);
+    if (!format_name.empty() && !ParseLayoutFormat(format_name, format)) {
+        cerr << "Unknown format: " << format_name << endl;
+        return 1;
+    }
+
+#ifndef LAYOUT_STATS
+    if (stats) {
+        cerr << "Error: --stats needs a build with STATS=1" << endl;
+        return 1;
+    }
+#endif
+    // the sweep's chains run on their own threads and keep no stats
+    if (stats && sweep) {
+        cerr << "Error: --stats does not support --sweep" << endl;
         return 1;
     }
 
-    string filename = argv[1];
+    // long-running solver: line-delimited JSON on stdin or a Unix socket
+    if (!serve_path.empty()) {
+        SolverServer server;
+        server.params.wC = 0.6;
+        server.params.wX = 0.3;
+        server.params.neighborhood = neighborhood;
+        server.params.construction = construction;
+        if (serve_path == "stdin") return ServeStream(server, cin, cout);
+        return ServeUnixSocket(server, serve_path);
+    }
+
+    // in batch mode the instances come from --batch, so only the seed is positional
+    if (batch_path.empty() && args.empty()) {
+        cerr << "Usage: ./layout <input_file> [seed] [--sweep] [--stats] [--trace file.csv]" << endl;
+        cerr << "                              [--save-bin file] [--neighborhood name]" << endl;
+        cerr << "                              [--construct greedy|colored]" << endl;
+        cerr << "                              [--output file] [--format grid|csv|json]" << endl;
+        cerr << "       ./layout --batch <manifest|dir> [seed] [--out dir] [--workers n]" << endl;
+        cerr << "       ./layout --serve <stdin|socket_path>" << endl;
+        return 1;
+    }
 
     Params params;
     params.wC = 0.6;
     params.wX = 0.3;
+    params.neighborhood = neighborhood;
+    params.construction = construction;
 
     // seed for reproducibility
-    if (argc >= 3) {
-        params.seed = (unsigned)atoi(argv[2]);
+    size_t seed_arg = batch_path.empty() ? 1 : 0;
+    if (args.size() > seed_arg) {
+        params.seed = (unsigned)atoi(args[seed_arg].c_str());
     } else {
         params.seed = (unsigned)time(nullptr);
     }
     cout << "Using seed: " << params.seed << endl;
 
-    Instance inst = ReadInstance(filename, params);
+    // many instances in one process, summary goes to <out_dir>/summary.csv
+    if (!batch_path.empty()) {
+        vector<string> files = ListBatchFiles(batch_path);
+        cout << "Solving " << files.size() << " instances on " << workers
+             << " workers..." << endl;
+        vector<BatchResult> results = RunBatch(files, out_dir, params, 10000,
+                                               workers, 2 * workers);
+        int failed = 0;
+        for (const auto& r : results) {
+            if (!r.ok) failed++;
+        }
+        cout << "Done: " << results.size() - failed << " solved, " << failed
+             << " failed. Summary in " << out_dir << "/summary.csv" << endl;
+        return failed ? 1 : 0;
+    }
+
+    string filename = args[0];
+    if (!trace_file.empty()) StartTrace(1 << 16);
+
+    // an event with several halls: one search thread per hall plus
+    // cross-hall exchanges
+    if (IsEventFile(filename)) {
+        if (sweep) {
+            cerr << "Error: --sweep does not support multi-hall events" << endl;
+            return 1;
+        }
+        Event event;
+        {
+            STATS_PHASE(parse);
+            event = ReadEvent(filename, params);
+        }
+        cout << "Solving " << event.halls.size() << " halls..." << endl;
+        EventResult result = SolveEvent(event, 10000, params.seed, 10);
+        {
+            STATS_PHASE(output);
+            PrintEvent(result);
+
+            // one file per hall: solved.json -> solved.hall0.json, ...
+            for (size_t h = 0; h < result.halls.size(); h++) {
+                const Layout& hall = result.halls[h];
+                string tag = "hall" + to_string(h);
+                if (!output_file.empty() &&
+                    !WriteLayoutFile(TaggedFileName(output_file, tag), hall, format)) {
+                    return 1;
+                }
+                if (!save_bin.empty() &&
+                    !WriteBinaryInstance(TaggedFileName(save_bin, tag), hall.inst, true, false)) {
+                    return 1;
+                }
+            }
+        }
+
+        // parse and output on this thread, then each hall's search threads
+        if (stats) {
+            cout << "\n" << StatsJson(ThreadStats()) << endl;
+            for (size_t h = 0; h < result.stats.size(); h++) {
+                cout << "Hall " << h << ": " << StatsJson(result.stats[h]) << endl;
+            }
+        }
+        if (!trace_file.empty() && !FlushTraceCsv(trace_file)) return 1;
+        return 0;
+    }
+
+    Instance inst;
+    {
+        STATS_PHASE(parse);
+        inst = ReadInstance(filename, params);
+    }
+
+    // trade-off curve over a grid of weights instead of a single solve
+    if (sweep) {
+        vector<double> weights = {0.0, 0.3, 0.6, 0.9, 1.2, 1.5};
+        int threads = max(1u, thread::hardware_concurrency());
+        cout << "Sweeping " << weights.size() * weights.size()
+             << " weight pairs on " << threads << " threads..." << endl;
+        vector<SweepPoint> points = WeightSweep(inst, weights, weights, 10000,
+                                                params.seed, threads);
+        PrintSweep(points);
+
+        // one file per Pareto layout, in table order: solved.pareto0.json, ...
+        int k = 0;
+        for (const auto& p : points) {
+            if (!p.pareto) continue;
+            string tag = "pareto" + to_string(k++);
+            if (!output_file.empty() &&
+                !WriteLayoutFile(TaggedFileName(output_file, tag), p.layout, format)) {
+                return 1;
+            }
+            if (!save_bin.empty() &&
+                !WriteBinaryInstance(TaggedFileName(save_bin, tag), p.layout.inst, true, false)) {
+                return 1;
+            }
+        }
+        if (!trace_file.empty() && !FlushTraceCsv(trace_file)) return 1;
+        return 0;
+    }
+
     Layout layout;
     layout.inst = inst;
 
-    // run greedy
-    cout << "Running greedy..." << endl;
-    GreedySeed(layout);
+    // run greedy, or the colored construction
+    bool colored = construction == Construction::Colored;
+    cout << (colored ? "Running colored construction..." : "Running greedy...") << endl;
+    {
+        STATS_PHASE(greedy);
+        SeedLayout(layout);
+    }
 
     double greedy_score = ComputeTotalScore(layout);
-    int greedy_row_clash = ComputeRowClash(layout);
-    int greedy_across_clash = ComputeAcrossAisleClash(layout);
+    double greedy_row_clash = ComputeRowClash(layout);
+    double greedy_across_clash = ComputeAcrossAisleClash(layout);
 
-    cout << "Greedy Score: " << greedy_score << endl;
+    cout << (colored ? "Colored Score: " : "Greedy Score: ") << greedy_score << endl;
     cout << "  Row Clashes: " << greedy_row_clash << endl;
     cout << "  Across Clashes: " << greedy_across_clash << endl;
 
     // run local search
     cout << "\nRunning local search..." << endl;
-    LocalSearch(layout, 10000, params.seed);
+    {
+        STATS_PHASE(local_search);
+        LocalSearch(layout, 10000, params.seed);
+    }
 
     // print results
     double exposure = ComputeExposure(layout);
-    int row_clash = ComputeRowClash(layout);
-    int across_clash = ComputeAcrossAisleClash(layout);
+    double row_clash = ComputeRowClash(layout);
+    double across_clash = ComputeAcrossAisleClash(layout);
     double total_score = ComputeTotalScore(layout);
 
     cout << "\nFinal Score: " << total_score << endl;
@@ -64,7 +272,22 @@ int main(int argc, char** argv) {
     cout << "Exposure: " << exposure << endl;
     cout << endl;
 
-    PrintLayout(layout);
+    {
+        STATS_PHASE(output);
+        PrintLayout(layout);
+
+        if (!output_file.empty() && !WriteLayoutFile(output_file, layout, format)) {
+            return 1;
+        }
+
+        // solved layout in the binary format, for reloading without parsing
+        if (!save_bin.empty() && !WriteBinaryInstance(save_bin, layout.inst, true, false)) {
+            return 1;
+        }
+    }
+
+    if (stats) cout << "\n" << StatsJson(ThreadStats()) << endl;
+    if (!trace_file.empty() && !FlushTraceCsv(trace_file)) return 1;
 
     return 0;
 }
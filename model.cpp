@@ -1,3 +1,138 @@
 #include "model.h"
+#include <algorithm>
+#include <unordered_map>
 
-// No implementation needed for simple structs
+// Set or clear the bits of a rectangle in a slot bitset
+static void MarkRect(uint64_t* mask, const Params& p, const PlacementRule& rule, bool on) {
+    for (int r = max(0, rule.r0); r <= min(p.rows - 1, rule.r1); r++) {
+        for (int c = max(0, rule.c0); c <= min(p.cols - 1, rule.c1); c++) {
+            int idx = r * p.cols + c;
+            if (on) {
+                mask[idx >> 6] |= 1ull << (idx & 63);
+            } else {
+                mask[idx >> 6] &= ~(1ull << (idx & 63));
+            }
+        }
+    }
+}
+
+// Apply rules to a mask: allow rules replace "anywhere" by the union of
+// their rectangles, then forbid rules clear theirs
+static void ApplyRules(uint64_t* mask, int words, const Params& p,
+                       const vector<const PlacementRule*>& rules) {
+    bool any_allow = false;
+    for (const auto* rule : rules) any_allow |= rule->allow;
+    if (any_allow) {
+        vector<uint64_t> zone(words, 0);
+        for (const auto* rule : rules) {
+            if (rule->allow) MarkRect(zone.data(), p, *rule, true);
+        }
+        for (int w = 0; w < words; w++) mask[w] &= zone[w];
+    }
+    for (const auto* rule : rules) {
+        if (!rule->allow) MarkRect(mask, p, *rule, false);
+    }
+}
+
+// One bitset per constrained category, plus one per booth that has rules
+// of its own (combined with its category's)
+static void CompileRules(Instance& inst) {
+    inst.booth_mask.assign(inst.booths.size(), -1);
+    inst.allowed.clear();
+    size_t slots = (size_t)inst.params.rows * inst.params.cols;
+    int words = (slots + 63) / 64;
+    inst.mask_words = words;
+    if (inst.rules.empty()) return;
+
+    int n = inst.num_cat_ids;
+    vector<vector<const PlacementRule*>> cat_rules(n);
+    vector<vector<const PlacementRule*>> booth_rules(inst.booths.size());
+    for (const auto& rule : inst.rules) {
+        if (rule.booth_id >= 0) {
+            booth_rules[rule.booth_id].push_back(&rule);
+            continue;
+        }
+        for (int k = 1; k < n; k++) {
+            if (inst.categories[k - 1] == rule.category) cat_rules[k].push_back(&rule);
+        }
+    }
+
+    auto new_mask = [&](int from) {
+        int m = inst.allowed.size() / words;
+        if (from < 0) {
+            inst.allowed.resize(inst.allowed.size() + words, ~0ull);
+        } else {
+            inst.allowed.resize(inst.allowed.size() + words);
+            copy_n(inst.allowed.begin() + (size_t)from * words, words,
+                   inst.allowed.begin() + (size_t)m * words);
+        }
+        return m;
+    };
+
+    vector<int> cat_mask(n, -1);
+    for (int k = 1; k < n; k++) {
+        if (cat_rules[k].empty()) continue;
+        cat_mask[k] = new_mask(-1);
+        ApplyRules(&inst.allowed[(size_t)cat_mask[k] * words], words, inst.params,
+                   cat_rules[k]);
+    }
+    for (size_t b = 0; b < inst.booths.size(); b++) {
+        int from = cat_mask[inst.booth_cat[b + 1]];
+        if (booth_rules[b].empty()) {
+            inst.booth_mask[b] = from;
+            continue;
+        }
+        inst.booth_mask[b] = new_mask(from);
+        ApplyRules(&inst.allowed[(size_t)inst.booth_mask[b] * words], words, inst.params,
+                   booth_rules[b]);
+    }
+}
+
+void CompileInstance(Instance& inst) {
+    // ids in order of first use, booths first
+    unordered_map<string, int> ids;
+    inst.categories.clear();
+    auto intern = [&](const string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        inst.categories.push_back(name);
+        ids.emplace(name, (int)inst.categories.size());
+        return (int)inst.categories.size();
+    };
+
+    inst.booth_cat.assign(inst.booths.size() + 1, 0);
+    for (size_t i = 0; i < inst.booths.size(); i++) {
+        inst.booth_cat[i + 1] = intern(inst.booths[i].category);
+    }
+    for (const auto& c : inst.conflicts) {
+        intern(c.a);
+        intern(c.b);
+    }
+
+    int n = inst.categories.size() + 1;
+    inst.num_cat_ids = n;
+    inst.conflict.clear();
+    inst.sparse_conflict.clear();
+    if (!inst.conflicts.empty() && n <= kDenseConflictIds) {
+        inst.conflict.assign((size_t)n * n, 0.0);
+        for (int k = 1; k < n; k++) {
+            inst.conflict[(size_t)k * n + k] = 1.0;
+        }
+        for (const auto& c : inst.conflicts) {
+            int a = ids[c.a], b = ids[c.b];
+            inst.conflict[(size_t)a * n + b] = c.weight;
+            inst.conflict[(size_t)b * n + a] = c.weight;
+        }
+    } else {
+        // later declarations win, as in the table
+        for (const auto& c : inst.conflicts) {
+            inst.sparse_conflict[Instance::ConflictKey(ids[c.a], ids[c.b])] = c.weight;
+        }
+    }
+
+    CompileRules(inst);
+}
+
+void EnsureCompiled(Instance& inst) {
+    if (!inst.Compiled()) CompileInstance(inst);
+}
@@ -1,7 +1,9 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -21,12 +23,47 @@ struct Slot {
     int booth_id = -1; // -1 means empty
 };
 
+// Which neighboring slots can clash (see neighborhood.h)
+enum class Neighborhood {
+    Four,       // left/right = row, above/below = across aisle
+    Diagonal,   // Four plus diagonals (across aisle)
+    WideAisle,  // Four plus two rows up/down (across aisle)
+    BackToBack, // Four, but rows 2k and 2k+1 share a back wall and never clash
+};
+
+// How the starting layout is built (see greedy.h)
+enum class Construction {
+    Greedy,  // GreedySeed: every booth into its best slot, by value
+    Colored, // ColoredSeed: categories spread over a coloring of the grid
+};
+
 // Problem parameters
 struct Params {
     int rows, cols;
     double wC = 0.6;  // row clash weight
     double wX = 0.3;  // across-aisle clash weight
     unsigned seed = 0;
+    Neighborhood neighborhood = Neighborhood::Four;
+    Construction construction = Construction::Greedy;
+};
+
+// Penalty weight for two categories being neighbors. Same-category pairs
+// weigh 1 and different categories 0 unless listed; a negative weight is a
+// reward for complementary neighbors.
+struct CategoryConflict {
+    string a, b;
+    double weight;
+};
+
+// Restricts where a booth, or every booth of a category, may be placed.
+// Allow rules limit it to their rectangles (several allow rules add up),
+// forbid rules keep it out of theirs. Pinning a sponsor to its contracted
+// slot is an allow rule on a single slot.
+struct PlacementRule {
+    bool allow;
+    int booth_id;       // the booth, or -1 for a category rule
+    string category;    // only for category rules
+    int r0, c0, r1, c1; // inclusive rectangle
 };
 
 // Complete problem instance
@@ -34,6 +71,60 @@ struct Instance {
     Params params;
     vector<Booth> booths;
     vector<Slot> slots; // size = rows * cols
+    vector<CategoryConflict> conflicts; // optional, as loaded
+    vector<PlacementRule> rules;        // optional, as loaded
+
+    // Filled in by CompileInstance from booths, conflicts and rules
+    vector<string> categories;  // category id k is categories[k - 1]
+    vector<int> booth_cat;      // booth_id + 1 -> category id, [0] = 0 = empty
+    vector<double> conflict;    // (K+1) x (K+1) weights, row/col 0 all zero,
+                                // or empty (see kDenseConflictIds)
+    unordered_map<uint64_t, double> sparse_conflict; // declared pairs, when
+                                                     // conflict is empty
+    int num_cat_ids = 1;        // K + 1, the row stride of conflict
+    vector<int> booth_mask;     // booth_id -> mask in allowed, -1 = anywhere
+    vector<uint64_t> allowed;   // slot bitsets, mask_words words each
+    int mask_words = 0;
+
+    // true once CompileInstance has run for the current booths and grid
+    bool Compiled() const {
+        return booth_cat.size() == booths.size() + 1 &&
+               mask_words == (int)(((size_t)params.rows * params.cols + 63) / 64);
+    }
+
+    // Conflict weight of two category ids, 0 if either is empty. Without
+    // the dense table: the declared weight, else 1 for the same category.
+    double Conflict(int a, int b) const {
+        if (a == 0 || b == 0) return 0.0;
+        if (!conflict.empty()) return conflict[(size_t)a * num_cat_ids + b];
+        if (!sparse_conflict.empty()) {
+            auto it = sparse_conflict.find(ConflictKey(a, b));
+            if (it != sparse_conflict.end()) return it->second;
+        }
+        return a == b ? 1.0 : 0.0;
+    }
+
+    static uint64_t ConflictKey(int a, int b) {
+        if (a > b) swap(a, b);
+        return (uint64_t)a << 32 | (uint32_t)b;
+    }
+
+    // category id of whatever is in a slot (0 if empty)
+    int SlotCategory(int slot_idx) const {
+        return booth_cat[slots[slot_idx].booth_id + 1];
+    }
+
+    // true if the placement rules let the booth go into the slot (blocked
+    // slots are checked separately)
+    bool Allowed(int booth_id, int slot_idx) const {
+        return MaskAllows(booth_mask[booth_id], slot_idx);
+    }
+
+    // same test for mask m of allowed (-1 = anywhere)
+    bool MaskAllows(int m, int slot_idx) const {
+        return m < 0 ||
+               (allowed[(size_t)m * mask_words + (slot_idx >> 6)] >> (slot_idx & 63)) & 1;
+    }
 
     // helper to convert (r,c) to flat index
     int index(int r, int c) const {
@@ -41,6 +132,28 @@ struct Instance {
     }
 };
 
+// The dense conflict table is only built when conflicts are declared and
+// there are at most this many category ids (32 MB of weights). Without
+// conflicts every pair is the same-category rule, which needs no table;
+// with more categories the declared pairs go into sparse_conflict.
+const int kDenseConflictIds = 2048;
+
+// Intern category names, build the conflict weights and compile the
+// placement rules into slot bitsets. Parsers and the generator call this;
+// the solver and scoring entry points compile an instance that was filled
+// by hand on first use (scoring a compiled copy, as they take it const).
+void CompileInstance(Instance& inst);
+
+// CompileInstance unless the instance is compiled already
+void EnsureCompiled(Instance& inst);
+
+// An event spread over several halls, each with its own grid, bonuses,
+// blocked slots and rules. Every hall holds the full booth list (same ids
+// and conflicts), and each booth is placed in at most one hall.
+struct Event {
+    vector<Instance> halls;
+};
+
 // Layout represents a solution
 struct Layout {
     Instance inst;
@@ -0,0 +1,111 @@
+#ifndef NEIGHBORHOOD_H
+#define NEIGHBORHOOD_H
+
+#include "model.h"
+#include <utility>
+
+using namespace std;
+
+// Neighborhood policies: which slots around (r, c) count as neighbors and
+// whether a clash with them is a row clash (weight wC) or an across-aisle
+// clash (weight wX). Full scoring, the move deltas and the greedy
+// contribution are all generated from these definitions.
+//
+// A policy has a constexpr table kOffsets, which must be symmetric (every
+// (dr, dc) has a matching (-dr, -dc)), and a constexpr Pairs(r, dr, dc)
+// that can switch off some pairs depending on the row.
+
+enum ClashKind { kRowClash = 0, kAcrossClash = 1 };
+
+struct Offset {
+    int dr, dc;
+    ClashKind kind;
+};
+
+// Left/right = row clash, above/below = across-aisle clash (the original rule)
+struct FourNeighbor {
+    static constexpr Offset kOffsets[] = {
+        {0, -1, kRowClash}, {0, 1, kRowClash},
+        {-1, 0, kAcrossClash}, {1, 0, kAcrossClash},
+    };
+    static constexpr bool Pairs(int, int, int) { return true; }
+};
+
+// Four neighbors plus diagonals, which count as across-aisle clashes
+struct DiagonalNeighbor {
+    static constexpr Offset kOffsets[] = {
+        {0, -1, kRowClash}, {0, 1, kRowClash},
+        {-1, 0, kAcrossClash}, {1, 0, kAcrossClash},
+        {-1, -1, kAcrossClash}, {-1, 1, kAcrossClash},
+        {1, -1, kAcrossClash}, {1, 1, kAcrossClash},
+    };
+    static constexpr bool Pairs(int, int, int) { return true; }
+};
+
+// Wide aisles: booths two rows apart still see each other
+struct WideAisleNeighbor {
+    static constexpr Offset kOffsets[] = {
+        {0, -1, kRowClash}, {0, 1, kRowClash},
+        {-1, 0, kAcrossClash}, {1, 0, kAcrossClash},
+        {-2, 0, kAcrossClash}, {2, 0, kAcrossClash},
+    };
+    static constexpr bool Pairs(int, int, int) { return true; }
+};
+
+// Back-to-back rows: rows 2k and 2k+1 share a back wall and do not see
+// each other; rows 2k+1 and 2k+2 face each other across an aisle
+struct BackToBackNeighbor {
+    static constexpr Offset kOffsets[] = {
+        {0, -1, kRowClash}, {0, 1, kRowClash},
+        {-1, 0, kAcrossClash}, {1, 0, kAcrossClash},
+    };
+    static constexpr bool Pairs(int r, int dr, int) {
+        int upper = dr < 0 ? r + dr : r; // upper row of the pair
+        return dr == 0 || upper % 2 == 1;
+    }
+};
+
+// Call f(policy) with the policy type selected at run time, so the kernels
+// are instantiated once per policy and the choice is made outside the loops
+template <typename F>
+auto WithNeighborhood(Neighborhood n, F f) {
+    switch (n) {
+    case Neighborhood::Diagonal: return f(DiagonalNeighbor{});
+    case Neighborhood::WideAisle: return f(WideAisleNeighbor{});
+    case Neighborhood::BackToBack: return f(BackToBackNeighbor{});
+    case Neighborhood::Four: break;
+    }
+    return f(FourNeighbor{});
+}
+
+// Call f(index, offset) for every in-grid neighbor of (r, c). The offset
+// table is expanded at compile time, so there is no loop over it.
+template <typename N, typename F, size_t... I>
+inline void ForEachNeighborImpl(const Params& p, int r, int c, F& f,
+                                index_sequence<I...>) {
+    (([&] {
+        constexpr Offset o = N::kOffsets[I];
+        int nr = r + o.dr, nc = c + o.dc;
+        if (nr >= 0 && nr < p.rows && nc >= 0 && nc < p.cols &&
+            N::Pairs(r, o.dr, o.dc)) {
+            f(nr * p.cols + nc, o);
+        }
+    }()), ...);
+}
+
+template <typename N, typename F>
+inline void ForEachNeighbor(const Params& p, int r, int c, F f) {
+    constexpr size_t n = sizeof(N::kOffsets) / sizeof(N::kOffsets[0]);
+    ForEachNeighborImpl<N>(p, r, c, f, make_index_sequence<n>{});
+}
+
+// Same as ForEachNeighbor, but only the forward half of the offsets, so
+// every unordered pair of slots is visited once
+template <typename N, typename F>
+inline void ForEachForwardNeighbor(const Params& p, int r, int c, F f) {
+    ForEachNeighbor<N>(p, r, c, [&](int idx, const Offset& o) {
+        if (o.dr > 0 || (o.dr == 0 && o.dc > 0)) f(idx, o);
+    });
+}
+
+#endif
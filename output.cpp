@@ -0,0 +1,314 @@
+#include "output.h"
+#include "score.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Output buffer filled in place with to_chars. Writers reserve room for a
+// whole record with Need() and then write through a plain pointer, so
+// there is one capacity check per record rather than one per field. The
+// caller sizes the buffer up front; Need() only grows it if that was short.
+struct OutBuf {
+    string data;
+    size_t len = 0;
+
+    explicit OutBuf(size_t estimate) { data.resize(estimate); }
+
+    char* Need(size_t n) {
+        if (len + n > data.size()) data.resize(max(2 * data.size(), len + n));
+        return &data[len];
+    }
+    void Done(char* end) { len = end - data.data(); }
+    void Put(string_view s) { Done(copy(s.begin(), s.end(), Need(s.size()))); }
+    string Take() {
+        data.resize(len);
+        return move(data);
+    }
+};
+
+// Field writers: each needs at most kMaxNumber bytes for a number
+static const size_t kMaxNumber = 32;
+
+static char* PutStr(char* p, string_view s) {
+    return copy(s.begin(), s.end(), p);
+}
+
+static char* PutInt(char* p, long long v) {
+    return to_chars(p, p + kMaxNumber, v).ptr;
+}
+
+// Shortest round-trip text like to_chars, but values with up to four
+// decimals (all bonuses and values in practice) are printed as scaled
+// integers, which is several times faster
+static char* PutDouble(char* p, double v) {
+    static const double kPow10[] = {1, 10, 100, 1000, 10000};
+    for (int k = 0; k < 5; k++) {
+        double scaled = v * kPow10[k];
+        if (fabs(scaled) >= 9e15) break;
+        long long n = llround(scaled);
+        if ((double)n / kPow10[k] != v) continue;
+        if (n < 0 || (n == 0 && signbit(v))) {
+            *p++ = '-';
+            n = -n;
+        }
+        p = PutInt(p, n / (long long)kPow10[k]);
+        if (k > 0) {
+            *p++ = '.';
+            long long frac = n % (long long)kPow10[k];
+            for (int d = k - 1; d >= 0; d--) {
+                p[d] = '0' + frac % 10;
+                frac /= 10;
+            }
+            p += k;
+        }
+        return p;
+    }
+    return to_chars(p, p + kMaxNumber, v).ptr;
+}
+
+// right-aligned in a field of `width` characters
+static char* PutPadded(char* p, string_view s, int width) {
+    for (int i = (int)s.size(); i < width; i++) *p++ = ' ';
+    return PutStr(p, s);
+}
+
+bool ParseLayoutFormat(const string& name, LayoutFormat& out) {
+    if (name == "grid") out = LayoutFormat::Grid;
+    else if (name == "csv") out = LayoutFormat::Csv;
+    else if (name == "json") out = LayoutFormat::Json;
+    else return false;
+    return true;
+}
+
+LayoutFormat LayoutFormatFor(const string& filename) {
+    auto ends_with = [&](const string& ext) {
+        return filename.size() >= ext.size() &&
+               filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    if (ends_with(".csv")) return LayoutFormat::Csv;
+    if (ends_with(".json")) return LayoutFormat::Json;
+    return LayoutFormat::Grid;
+}
+
+static int Digits(int v) {
+    int d = 1;
+    while (v >= 10) {
+        v /= 10;
+        d++;
+    }
+    return d;
+}
+
+// wide enough for the largest booth id plus a separating space
+static int GridWidth(const Instance& inst) {
+    return max(3, Digits(max(0, (int)inst.booths.size() - 1)) + 1);
+}
+
+static void FormatGrid(const Layout& L, OutBuf& out) {
+    const Instance& inst = L.inst;
+    int width = GridWidth(inst);
+    for (int r = 0; r < inst.params.rows; r++) {
+        char* p = out.Need((size_t)inst.params.cols * width + 1);
+        for (int c = 0; c < inst.params.cols; c++) {
+            const Slot& s = inst.slots[inst.index(r, c)];
+            if (s.blocked) {
+                p = PutPadded(p, "X", width);
+            } else if (s.booth_id == -1) {
+                p = PutPadded(p, ".", width);
+            } else {
+                char tmp[16];
+                char* end = to_chars(tmp, tmp + sizeof(tmp), s.booth_id).ptr;
+                p = PutPadded(p, string_view(tmp, end - tmp), width);
+            }
+        }
+        *p++ = '\n';
+        out.Done(p);
+    }
+}
+
+// Category names are single tokens, but quote them if they ever need it
+// (needs up to 2 * size + 2 bytes)
+static char* PutCsvField(char* p, const string& s) {
+    if (s.find_first_of(",\"\n") == string::npos) return PutStr(p, s);
+    *p++ = '"';
+    for (char ch : s) {
+        if (ch == '"') *p++ = '"';
+        *p++ = ch;
+    }
+    *p++ = '"';
+    return p;
+}
+
+static void FormatCsv(const Layout& L, OutBuf& out) {
+    const Instance& inst = L.inst;
+    out.Put("booth_id,r,c,category,value,bonus\n");
+    for (const auto& s : inst.slots) {
+        if (s.booth_id < 0) continue;
+        const Booth& b = inst.booths[s.booth_id];
+        char* p = out.Need(5 * kMaxNumber + 2 * b.category.size() + 8);
+        p = PutInt(p, s.booth_id);
+        *p++ = ',';
+        p = PutInt(p, s.r);
+        *p++ = ',';
+        p = PutInt(p, s.c);
+        *p++ = ',';
+        p = PutCsvField(p, b.category);
+        *p++ = ',';
+        p = PutDouble(p, b.value);
+        *p++ = ',';
+        p = PutDouble(p, s.bonus);
+        *p++ = '\n';
+        out.Done(p);
+    }
+}
+
+// JSON string with escapes (needs up to 6 * size + 2 bytes)
+static char* PutJsonString(char* p, const string& s) {
+    static const char kHex[] = "0123456789abcdef";
+    *p++ = '"';
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            *p++ = '\\';
+            *p++ = ch;
+        } else if ((unsigned char)ch < 0x20) {
+            p = PutStr(p, "\\u00");
+            *p++ = kHex[ch >> 4];
+            *p++ = kHex[ch & 15];
+        } else {
+            *p++ = ch;
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+static void FormatJson(const Layout& L, OutBuf& out) {
+    const Instance& inst = L.inst;
+    const Params& params = inst.params;
+    ScoreParts parts = ComputeScoreParts(L);
+    char* p = out.Need(256);
+    p = PutStr(p, "{\"rows\":");
+    p = PutInt(p, params.rows);
+    p = PutStr(p, ",\"cols\":");
+    p = PutInt(p, params.cols);
+    p = PutStr(p, ",\"score\":");
+    p = PutDouble(p, parts.Score(params.wC, params.wX));
+    p = PutStr(p, ",\"exposure\":");
+    p = PutDouble(p, parts.exposure);
+    p = PutStr(p, ",\"row_clash\":");
+    p = PutDouble(p, parts.row_clash);
+    p = PutStr(p, ",\"across_clash\":");
+    p = PutDouble(p, parts.across_clash);
+    p = PutStr(p, ",\"wC\":");
+    p = PutDouble(p, params.wC);
+    p = PutStr(p, ",\"wX\":");
+    p = PutDouble(p, params.wX);
+    p = PutStr(p, ",\n\"booths\":[");
+    out.Done(p);
+
+    bool first = true;
+    for (const auto& s : inst.slots) {
+        if (s.booth_id < 0) continue;
+        const Booth& b = inst.booths[s.booth_id];
+        p = out.Need(5 * kMaxNumber + 6 * b.category.size() + 64);
+        p = PutStr(p, first ? "\n{\"id\":" : ",\n{\"id\":");
+        first = false;
+        p = PutInt(p, s.booth_id);
+        p = PutStr(p, ",\"r\":");
+        p = PutInt(p, s.r);
+        p = PutStr(p, ",\"c\":");
+        p = PutInt(p, s.c);
+        p = PutStr(p, ",\"category\":");
+        p = PutJsonString(p, b.category);
+        p = PutStr(p, ",\"value\":");
+        p = PutDouble(p, b.value);
+        p = PutStr(p, ",\"bonus\":");
+        p = PutDouble(p, s.bonus);
+        *p++ = '}';
+        out.Done(p);
+    }
+
+    // same grid encoding as the server: booth id, -1 empty, -2 blocked
+    out.Put("],\n\"layout\":[");
+    for (int r = 0; r < params.rows; r++) {
+        p = out.Need((size_t)params.cols * kMaxNumber + 4);
+        p = PutStr(p, r ? ",\n[" : "\n[");
+        for (int c = 0; c < params.cols; c++) {
+            const Slot& s = inst.slots[inst.index(r, c)];
+            if (c) *p++ = ',';
+            p = PutInt(p, s.blocked ? -2 : s.booth_id);
+        }
+        *p++ = ']';
+        out.Done(p);
+    }
+    out.Put("]}\n");
+}
+
+string FormatLayout(const Layout& L, LayoutFormat format) {
+    // size the buffer close to the real output: it is written once, and
+    // touching much more memory than needed costs more than the formatting
+    const Instance& inst = L.inst;
+    size_t cells = inst.slots.size();
+    size_t placed = 0, category_chars = 0;
+    for (const auto& s : inst.slots) {
+        if (s.booth_id < 0) continue;
+        placed++;
+        category_chars += inst.booths[s.booth_id].category.size();
+    }
+    int id_width = GridWidth(inst);
+    size_t estimate = 0;
+    switch (format) {
+    case LayoutFormat::Grid:
+        estimate = cells * id_width + inst.params.rows;
+        break;
+    case LayoutFormat::Csv:
+        estimate = 64 + placed * (3 * id_width + 16) + category_chars;
+        break;
+    case LayoutFormat::Json:
+        estimate = 256 + placed * (3 * id_width + 64) + category_chars + cells * id_width;
+        break;
+    }
+
+    OutBuf out(estimate);
+    switch (format) {
+    case LayoutFormat::Grid: FormatGrid(L, out); break;
+    case LayoutFormat::Csv: FormatCsv(L, out); break;
+    case LayoutFormat::Json: FormatJson(L, out); break;
+    }
+    return out.Take();
+}
+
+bool WriteAll(int fd, const string& buf) {
+    const char* p = buf.data();
+    size_t left = buf.size();
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        left -= n;
+    }
+    return true;
+}
+
+bool WriteLayoutFile(const string& filename, const Layout& L, LayoutFormat format) {
+    string buf = FormatLayout(L, format);
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Error: cannot write to " << filename << endl;
+        return false;
+    }
+    bool ok = WriteAll(fd, buf);
+    if (close(fd) != 0) ok = false;
+    if (!ok) cerr << "Error: cannot write to " << filename << endl;
+    return ok;
+}
@@ -0,0 +1,34 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "model.h"
+#include <string>
+
+using namespace std;
+
+// Layout output formats
+enum class LayoutFormat {
+    Grid, // one line per row: booth id, '.' for empty, 'X' for blocked
+    Csv,  // booth_id,r,c,category,value,bonus for every placed booth
+    Json, // dimensions, score breakdown, booths and the grid
+};
+
+// Parse a format name: grid, csv or json
+bool ParseLayoutFormat(const string& name, LayoutFormat& out);
+
+// Format from a file name: .csv, .json, anything else is grid
+LayoutFormat LayoutFormatFor(const string& filename);
+
+// Format a layout into one buffer with to_chars. Grid cells are padded to
+// the width of the largest booth id, so columns line up and stay
+// separated for any grid size.
+string FormatLayout(const Layout& L, LayoutFormat format);
+
+// Write the whole buffer to fd, with a single write() unless the kernel
+// takes it in parts
+bool WriteAll(int fd, const string& buf);
+
+// Format a layout and write it to a file
+bool WriteLayoutFile(const string& filename, const Layout& L, LayoutFormat format);
+
+#endif
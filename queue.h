@@ -0,0 +1,49 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+// Fixed-capacity blocking queue used to pipeline work between threads.
+// Push blocks while the queue is full, Pop blocks while it is empty.
+// After Close, Pop drains what is left and then returns false.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    void Push(T item) {
+        unique_lock<mutex> lock(mu_);
+        not_full_.wait(lock, [&] { return items_.size() < capacity_; });
+        items_.push_back(move(item));
+        not_empty_.notify_one();
+    }
+
+    bool Pop(T& item) {
+        unique_lock<mutex> lock(mu_);
+        not_empty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        if (items_.empty()) return false;
+        item = move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void Close() {
+        lock_guard<mutex> lock(mu_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_ = false;
+    deque<T> items_;
+    mutex mu_;
+    condition_variable not_full_, not_empty_;
+};
+
+#endif
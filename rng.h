@@ -0,0 +1,111 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// xoshiro256** (Blackman and Vigna). A draw is a few shifts, rotates and
+// xors on 32 bytes of state, against mt19937's 2.5 KB state and periodic
+// regeneration. The output is the same on every compiler and standard
+// library, so results only depend on (seed, stream).
+//
+// Searches that run in parallel within one solve get their own stream id:
+// every (wC, wX) point of a sweep, and every hall in every round of an
+// event (stream 0 is the event's coordinator). Rng(seed, stream) fills
+// the state by running SplitMix64 over the seed and the stream id, so
+// streams never depend on which thread ran first or how many threads ran.
+// Batch instances and server solves instead get their own seed (base seed
+// + index, or + solve count) on stream 0, so a single run with the
+// reported seed reproduces them.
+// Jump() advances 2^128 draws, for splitting one stream into substreams
+// that are guaranteed not to overlap.
+struct Rng {
+    uint64_t s[4];
+
+    explicit Rng(uint64_t seed, uint64_t stream = 0) {
+        uint64_t x = seed;
+        uint64_t key = SplitMix(x) ^ Mix(stream + 0x6a09e667f3bcc909ULL);
+        for (auto& w : s) w = SplitMix(key);
+    }
+
+    uint64_t Next() {
+        uint64_t result = Rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rotl(s[3], 45);
+        return result;
+    }
+
+    // uniform in [0, n) by Lemire's multiply-shift, with the rejection step
+    // so no value is favored; n must be > 0
+    uint32_t Below(uint32_t n) {
+        uint64_t m = (Next() >> 32) * n;
+        uint32_t low = (uint32_t)m;
+        if (low < n) {
+            uint32_t threshold = (0u - n) % n;
+            while (low < threshold) {
+                m = (Next() >> 32) * n;
+                low = (uint32_t)m;
+            }
+        }
+        return m >> 32;
+    }
+
+    // uniform in [0, 1) with 53 random bits
+    double Uniform() { return (Next() >> 11) * 0x1.0p-53; }
+
+    void Jump() {
+        static const uint64_t kJump[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                         0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        uint64_t t[4] = {0, 0, 0, 0};
+        for (uint64_t word : kJump) {
+            for (int b = 0; b < 64; b++) {
+                if (word & (1ULL << b)) {
+                    for (int i = 0; i < 4; i++) t[i] ^= s[i];
+                }
+                Next();
+            }
+        }
+        for (int i = 0; i < 4; i++) s[i] = t[i];
+    }
+
+    // UniformRandomBitGenerator, so <random> distributions accept it too
+    using result_type = uint64_t;
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return ~0ULL; }
+    uint64_t operator()() { return Next(); }
+
+private:
+    static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    static uint64_t Mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static uint64_t SplitMix(uint64_t& x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        return Mix(x);
+    }
+};
+
+// Move k elements chosen uniformly at random to the front of v (a partial
+// Fisher-Yates shuffle): O(k) draws, where shuffling all of v is O(size)
+template <typename T>
+void SampleFront(vector<T>& v, size_t k, Rng& rng) {
+    if (k > v.size()) k = v.size();
+    for (size_t i = 0; i < k; i++) {
+        size_t j = i + rng.Below((uint32_t)(v.size() - i));
+        swap(v[i], v[j]);
+    }
+}
+
+#endif
@@ -1,7 +1,108 @@
 #include "score.h"
+#include "neighborhood.h"
 
 using namespace std;
 
+// Conflict weight of a booth of category cat against a neighbor's
+// category. Like the neighborhood, the lookup is picked once per call: a
+// row of the dense table (the empty category 0 has weight 0, so no
+// branch), the plain same-category rule when no conflicts are declared,
+// or a hash lookup of the declared pairs when there are too many
+// categories for the table.
+struct DenseWeights {
+    const double* row;
+    double operator()(int other) const { return row[other]; }
+};
+
+struct SameCategoryWeights {
+    int cat; // -1 for an empty slot, so it matches nothing
+    double operator()(int other) const { return other == cat ? 1.0 : 0.0; }
+};
+
+struct SparseWeights {
+    const Instance* inst;
+    int cat;
+    double operator()(int other) const { return inst->Conflict(cat, other); }
+};
+
+template <typename F>
+static auto WithWeights(const Instance& inst, int cat, F f) {
+    if (!inst.conflict.empty()) {
+        return f(DenseWeights{&inst.conflict[(size_t)cat * inst.num_cat_ids]});
+    }
+    if (inst.sparse_conflict.empty()) return f(SameCategoryWeights{cat ? cat : -1});
+    return f(SparseWeights{&inst, cat});
+}
+
+// Weighted clash of every pair of neighbors, each pair once
+template <typename N>
+static ClashCounts CountClashPairs(const Instance& inst) {
+    ClashCounts counts;
+    for (int r = 0; r < inst.params.rows; r++) {
+        for (int c = 0; c < inst.params.cols; c++) {
+            int cat = inst.SlotCategory(inst.index(r, c));
+            if (cat == 0) continue;
+            WithWeights(inst, cat, [&](auto weights) {
+                ForEachForwardNeighbor<N>(inst.params, r, c, [&](int nb, const Offset& o) {
+                    (o.kind == kRowClash ? counts.row : counts.across) +=
+                        weights(inst.SlotCategory(nb));
+                });
+            });
+        }
+    }
+    return counts;
+}
+
+// Weighted clashes a booth of category cat would have at slot_idx, not
+// counting the slot `ignore` (the other end of a move)
+template <typename N>
+static ClashCounts ClashesAt(const Instance& inst, int slot_idx, int cat, int ignore) {
+    const Slot& s = inst.slots[slot_idx];
+    return WithWeights(inst, cat, [&](auto weights) {
+        ClashCounts counts;
+        ForEachNeighbor<N>(inst.params, s.r, s.c, [&](int nb, const Offset& o) {
+            if (nb == ignore) return;
+            (o.kind == kRowClash ? counts.row : counts.across) +=
+                weights(inst.SlotCategory(nb));
+        });
+        return counts;
+    });
+}
+
+// Instances filled by hand may not be compiled yet. The scoring entry
+// points take them const, so they score a compiled copy instead.
+static Layout CompiledCopy(const Layout& L) {
+    Layout copy = L;
+    CompileInstance(copy.inst);
+    return copy;
+}
+
+static double Penalty(const Params& p, const ClashCounts& counts) {
+    return p.wC * counts.row + p.wX * counts.across;
+}
+
+static ClashCounts CountClashes(const Layout& L) {
+    if (!L.inst.Compiled()) return CountClashes(CompiledCopy(L));
+    return WithNeighborhood(L.inst.params.neighborhood, [&](auto policy) {
+        return CountClashPairs<decltype(policy)>(L.inst);
+    });
+}
+
+bool ParseNeighborhood(const string& name, Neighborhood& out) {
+    if (name == "four") {
+        out = Neighborhood::Four;
+    } else if (name == "diagonal") {
+        out = Neighborhood::Diagonal;
+    } else if (name == "wide") {
+        out = Neighborhood::WideAisle;
+    } else if (name == "backtoback") {
+        out = Neighborhood::BackToBack;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 double ComputeExposure(const Layout& L) {
     double total = 0.0;
     for (const auto& slot : L.inst.slots) {
@@ -12,87 +113,81 @@ double ComputeExposure(const Layout& L) {
     return total;
 }
 
-int ComputeRowClash(const Layout& L) {
-    int clash = 0;
-    for (int r = 0; r < L.inst.params.rows; r++) {
-        for (int c = 0; c < L.inst.params.cols - 1; c++) {
-            int idx1 = L.inst.index(r, c);
-            int idx2 = L.inst.index(r, c + 1);
-            int b1 = L.inst.slots[idx1].booth_id;
-            int b2 = L.inst.slots[idx2].booth_id;
-            if (b1 >= 0 && b2 >= 0) {
-                if (L.inst.booths[b1].category == L.inst.booths[b2].category) {
-                    clash++;
-                }
-            }
-        }
-    }
-    return clash;
-}
-
-int ComputeAcrossAisleClash(const Layout& L) {
-    int clash = 0;
-    for (int r = 0; r < L.inst.params.rows - 1; r++) {
-        for (int c = 0; c < L.inst.params.cols; c++) {
-            int idx1 = L.inst.index(r, c);
-            int idx2 = L.inst.index(r + 1, c);
-            int b1 = L.inst.slots[idx1].booth_id;
-            int b2 = L.inst.slots[idx2].booth_id;
-            if (b1 >= 0 && b2 >= 0) {
-                if (L.inst.booths[b1].category == L.inst.booths[b2].category) {
-                    clash++;
-                }
-            }
-        }
-    }
-    return clash;
+double ComputeRowClash(const Layout& L) {
+    return CountClashes(L).row;
+}
+
+double ComputeAcrossAisleClash(const Layout& L) {
+    return CountClashes(L).across;
 }
 
 double ComputeTotalScore(const Layout& L) {
-    double exposure = ComputeExposure(L);
-    int row_clash = ComputeRowClash(L);
-    int across_clash = ComputeAcrossAisleClash(L);
-    return exposure - L.inst.params.wC * row_clash - L.inst.params.wX * across_clash;
+    return ComputeScoreParts(L).Score(L.inst.params.wC, L.inst.params.wX);
 }
 
-// get category at a slot
-static string GetCategory(const Layout& L, int slot_idx) {
-    int bid = L.inst.slots[slot_idx].booth_id;
-    if (bid < 0) return "";
-    return L.inst.booths[bid].category;
+ScoreParts ComputeScoreParts(const Layout& L) {
+    ClashCounts counts = CountClashes(L);
+    ScoreParts parts;
+    parts.exposure = ComputeExposure(L);
+    parts.row_clash = counts.row;
+    parts.across_clash = counts.across;
+    return parts;
 }
 
-// count clashes at a slot
-static int CountClashesAtSlot(const Layout& L, int slot_idx) {
-    int r = L.inst.slots[slot_idx].r;
-    int c = L.inst.slots[slot_idx].c;
-    string cat = GetCategory(L, slot_idx);
-    if (cat.empty()) return 0;
+ClashCounts CountClashesAt(const Layout& L, int slot_idx, int category,
+                           int ignore_slot) {
+    if (!L.inst.Compiled()) {
+        return CountClashesAt(CompiledCopy(L), slot_idx, category, ignore_slot);
+    }
+    return WithNeighborhood(L.inst.params.neighborhood, [&](auto policy) {
+        return ClashesAt<decltype(policy)>(L.inst, slot_idx, category, ignore_slot);
+    });
+}
 
-    int clash = 0;
+double PlacementGain(const Layout& L, int booth_id, int slot_idx) {
+    if (!L.inst.Compiled()) return PlacementGain(CompiledCopy(L), booth_id, slot_idx);
+    const Booth& booth = L.inst.booths[booth_id];
+    ClashCounts counts = CountClashesAt(L, slot_idx, L.inst.booth_cat[booth_id + 1], -1);
+    return booth.value * L.inst.slots[slot_idx].bonus - Penalty(L.inst.params, counts);
+}
 
-    // Check left neighbor
-    if (c > 0) {
-        int left_idx = L.inst.index(r, c - 1);
-        if (GetCategory(L, left_idx) == cat) clash++;
-    }
-    // Check right neighbor
-    if (c < L.inst.params.cols - 1) {
-        int right_idx = L.inst.index(r, c + 1);
-        if (GetCategory(L, right_idx) == cat) clash++;
-    }
-    // Check above
-    if (r > 0) {
-        int above_idx = L.inst.index(r - 1, c);
-        if (GetCategory(L, above_idx) == cat) clash++;
-    }
-    // Check below
-    if (r < L.inst.params.rows - 1) {
-        int below_idx = L.inst.index(r + 1, c);
-        if (GetCategory(L, below_idx) == cat) clash++;
-    }
+double DeltaRelocateSlots(const Layout& L, int from, int to) {
+    if (!L.inst.Compiled()) return DeltaRelocateSlots(CompiledCopy(L), from, to);
+    const Instance& inst = L.inst;
+    const Booth& booth = inst.booths[inst.slots[from].booth_id];
+    int cat = inst.SlotCategory(from);
+    return WithNeighborhood(inst.params.neighborhood, [&](auto policy) {
+        using N = decltype(policy);
+        // the booth no longer neighbors its old slot once it has moved
+        ClashCounts old_clash = ClashesAt<N>(inst, from, cat, -1);
+        ClashCounts new_clash = ClashesAt<N>(inst, to, cat, from);
+        double delta_exposure = booth.value * (inst.slots[to].bonus - inst.slots[from].bonus);
+        return delta_exposure - Penalty(inst.params, new_clash)
+                              + Penalty(inst.params, old_clash);
+    });
+}
 
-    return clash;
+double DeltaSwapSlots(const Layout& L, int a, int b) {
+    if (!L.inst.Compiled()) return DeltaSwapSlots(CompiledCopy(L), a, b);
+    const Instance& inst = L.inst;
+    const Booth& booth_a = inst.booths[inst.slots[a].booth_id];
+    const Booth& booth_b = inst.booths[inst.slots[b].booth_id];
+    int cat_a = inst.SlotCategory(a), cat_b = inst.SlotCategory(b);
+    return WithNeighborhood(inst.params.neighborhood, [&](auto policy) {
+        using N = decltype(policy);
+        // a and b still neighbor each other after the swap, with the same
+        // pair of categories, so that pair is left out on both sides
+        ClashCounts old_a = ClashesAt<N>(inst, a, cat_a, b);
+        ClashCounts old_b = ClashesAt<N>(inst, b, cat_b, a);
+        ClashCounts new_a = ClashesAt<N>(inst, b, cat_a, a);
+        ClashCounts new_b = ClashesAt<N>(inst, a, cat_b, b);
+
+        double delta_exposure = (booth_a.value - booth_b.value) *
+                                (inst.slots[b].bonus - inst.slots[a].bonus);
+        return delta_exposure
+             - Penalty(inst.params, new_a) - Penalty(inst.params, new_b)
+             + Penalty(inst.params, old_a) + Penalty(inst.params, old_b);
+    });
 }
 
 double DeltaMoveRelocate(const Layout& L, int booth_id, int to_index) {
@@ -105,74 +200,7 @@ double DeltaMoveRelocate(const Layout& L, int booth_id, int to_index) {
         }
     }
     if (from_index < 0) return 0.0; // booth not placed
-
-    const Booth& booth = L.inst.booths[booth_id];
-
-    // Compute old contribution
-    double old_exposure = booth.value * L.inst.slots[from_index].bonus;
-    int old_row_clash = 0;
-    int old_across_clash = 0;
-
-    // Count clashes at old position
-    int r_old = L.inst.slots[from_index].r;
-    int c_old = L.inst.slots[from_index].c;
-
-    // left
-    if (c_old > 0) {
-        int left = L.inst.index(r_old, c_old - 1);
-        if (GetCategory(L, left) == booth.category) old_row_clash++;
-    }
-    // right
-    if (c_old < L.inst.params.cols - 1) {
-        int right = L.inst.index(r_old, c_old + 1);
-        if (GetCategory(L, right) == booth.category) old_row_clash++;
-    }
-    // above
-    if (r_old > 0) {
-        int above = L.inst.index(r_old - 1, c_old);
-        if (GetCategory(L, above) == booth.category) old_across_clash++;
-    }
-    // below
-    if (r_old < L.inst.params.rows - 1) {
-        int below = L.inst.index(r_old + 1, c_old);
-        if (GetCategory(L, below) == booth.category) old_across_clash++;
-    }
-
-    // Compute new contribution
-    double new_exposure = booth.value * L.inst.slots[to_index].bonus;
-    int new_row_clash = 0;
-    int new_across_clash = 0;
-
-    int r_new = L.inst.slots[to_index].r;
-    int c_new = L.inst.slots[to_index].c;
-
-    // left
-    if (c_new > 0) {
-        int left = L.inst.index(r_new, c_new - 1);
-        if (GetCategory(L, left) == booth.category) new_row_clash++;
-    }
-    // right
-    if (c_new < L.inst.params.cols - 1) {
-        int right = L.inst.index(r_new, c_new + 1);
-        if (GetCategory(L, right) == booth.category) new_row_clash++;
-    }
-    // above
-    if (r_new > 0) {
-        int above = L.inst.index(r_new - 1, c_new);
-        if (GetCategory(L, above) == booth.category) new_across_clash++;
-    }
-    // below
-    if (r_new < L.inst.params.rows - 1) {
-        int below = L.inst.index(r_new + 1, c_new);
-        if (GetCategory(L, below) == booth.category) new_across_clash++;
-    }
-
-    double delta_exposure = new_exposure - old_exposure;
-    int delta_row_clash = new_row_clash - old_row_clash;
-    int delta_across_clash = new_across_clash - old_across_clash;
-
-    return delta_exposure - L.inst.params.wC * delta_row_clash
-                          - L.inst.params.wX * delta_across_clash;
+    return DeltaRelocateSlots(L, from_index, to_index);
 }
 
 double DeltaMoveSwap(const Layout& L, int booth_id_a, int booth_id_b) {
@@ -182,29 +210,31 @@ double DeltaMoveSwap(const Layout& L, int booth_id_a, int booth_id_b) {
         if (L.inst.slots[i].booth_id == booth_id_a) pos_a = i;
         if (L.inst.slots[i].booth_id == booth_id_b) pos_b = i;
     }
-    if (pos_a < 0 || pos_b < 0) return 0.0;
-
-    const Booth& booth_a = L.inst.booths[booth_id_a];
-    const Booth& booth_b = L.inst.booths[booth_id_b];
-
-    // Compute old exposure
-    double old_exp = booth_a.value * L.inst.slots[pos_a].bonus
-                   + booth_b.value * L.inst.slots[pos_b].bonus;
-
-    // Compute new exposure
-    double new_exp = booth_a.value * L.inst.slots[pos_b].bonus
-                   + booth_b.value * L.inst.slots[pos_a].bonus;
-
-    // For clashes we need to count before and after
-    // Just recompute everything with a temp copy to keep it simple
-
-    // Temp copy for the swap
-    Layout temp = L;
-    temp.inst.slots[pos_a].booth_id = booth_id_b;
-    temp.inst.slots[pos_b].booth_id = booth_id_a;
-
-    double old_score = ComputeTotalScore(L);
-    double new_score = ComputeTotalScore(temp);
+    if (pos_a < 0 || pos_b < 0 || pos_a == pos_b) return 0.0;
+    return DeltaSwapSlots(L, pos_a, pos_b);
+}
 
-    return new_score - old_score;
+ClashCounts MoveClashChange(const Layout& L, int a, int b) {
+    if (!L.inst.Compiled()) return MoveClashChange(CompiledCopy(L), a, b);
+    const Instance& inst = L.inst;
+    int cat_a = inst.SlotCategory(a), cat_b = inst.SlotCategory(b);
+    return WithNeighborhood(inst.params.neighborhood, [&](auto policy) {
+        using N = decltype(policy);
+        // same terms as DeltaRelocateSlots and DeltaSwapSlots
+        ClashCounts change;
+        if (cat_b == 0) {
+            ClashCounts old_clash = ClashesAt<N>(inst, a, cat_a, -1);
+            ClashCounts new_clash = ClashesAt<N>(inst, b, cat_a, a);
+            change.row = new_clash.row - old_clash.row;
+            change.across = new_clash.across - old_clash.across;
+            return change;
+        }
+        ClashCounts old_a = ClashesAt<N>(inst, a, cat_a, b);
+        ClashCounts old_b = ClashesAt<N>(inst, b, cat_b, a);
+        ClashCounts new_a = ClashesAt<N>(inst, b, cat_a, a);
+        ClashCounts new_b = ClashesAt<N>(inst, a, cat_b, b);
+        change.row = new_a.row + new_b.row - old_a.row - old_b.row;
+        change.across = new_a.across + new_b.across - old_a.across - old_b.across;
+        return change;
+    });
 }
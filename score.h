@@ -6,19 +6,67 @@
 // Compute total exposure gain
 double ComputeExposure(const Layout& L);
 
-// Compute row clash count (same category adjacent horizontally)
-int ComputeRowClash(const Layout& L);
+// Which neighbors count as row or across-aisle clashes is set by
+// Params::neighborhood (see neighborhood.h). Each clashing pair counts
+// with its conflict weight (see Instance::Conflict), so without extra
+// conflicts the totals are plain counts of same-category pairs.
 
-// Compute across-aisle clash count (same category across aisle)
-int ComputeAcrossAisleClash(const Layout& L);
+// Compute row clash total (same category adjacent horizontally)
+double ComputeRowClash(const Layout& L);
+
+// Compute across-aisle clash total (same category across aisle)
+double ComputeAcrossAisleClash(const Layout& L);
 
 // Compute total score
 double ComputeTotalScore(const Layout& L);
 
+// Exposure and clash totals of a layout, cached so it can be rescored
+// under different weights in O(1)
+struct ScoreParts {
+    double exposure = 0.0;
+    double row_clash = 0.0;
+    double across_clash = 0.0;
+
+    double Score(double wC, double wX) const {
+        return exposure - wC * row_clash - wX * across_clash;
+    }
+};
+
+// Parse a neighborhood name: four, diagonal, wide or backtoback
+bool ParseNeighborhood(const string& name, Neighborhood& out);
+
+// Compute exposure and clash totals in one call
+ScoreParts ComputeScoreParts(const Layout& L);
+
 // Compute delta score for relocating a booth to a new slot
 double DeltaMoveRelocate(const Layout& L, int booth_id, int to_index);
 
 // Compute delta score for swapping two booths
 double DeltaMoveSwap(const Layout& L, int booth_id_a, int booth_id_b);
 
+// Same deltas for callers that already know the slots: move the booth in
+// slot `from` to the empty slot `to`, or swap the booths in slots a and b
+double DeltaRelocateSlots(const Layout& L, int from, int to);
+double DeltaSwapSlots(const Layout& L, int a, int b);
+
+// Weighted row and across-aisle clashes at one slot
+struct ClashCounts {
+    double row = 0.0;
+    double across = 0.0;
+};
+
+// Clashes a booth of category id `category` (see CompileInstance) would
+// have at slot_idx with the current neighbors, not counting ignore_slot
+// (-1 for none)
+ClashCounts CountClashesAt(const Layout& L, int slot_idx, int category,
+                           int ignore_slot);
+
+// Change of the weighted row and across-aisle clash totals when the
+// booth in slot a moves to slot b (swapping with the booth there, if any)
+ClashCounts MoveClashChange(const Layout& L, int a, int b);
+
+// Score gained by putting a booth into an empty slot: its exposure there
+// minus the clashes it would create
+double PlacementGain(const Layout& L, int booth_id, int slot_idx);
+
 #endif
@@ -0,0 +1,359 @@
+#include "server.h"
+#include "io.h"
+#include "score.h"
+#include "greedy.h"
+#include "localsearch.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Parse a flat JSON object into key -> raw value (strings unescaped).
+// Nested objects and arrays are not part of the protocol.
+static bool ParseRequest(const string& line, map<string, string>& out) {
+    size_t i = 0;
+    auto skip = [&]() {
+        while (i < line.size() && isspace((unsigned char)line[i])) i++;
+    };
+    auto read_string = [&](string& s) {
+        if (i >= line.size() || line[i] != '"') return false;
+        i++;
+        while (i < line.size() && line[i] != '"') {
+            if (line[i] == '\\' && i + 1 < line.size()) i++;
+            s += line[i++];
+        }
+        if (i >= line.size()) return false;
+        i++;
+        return true;
+    };
+
+    skip();
+    if (i >= line.size() || line[i] != '{') return false;
+    i++;
+    skip();
+    if (i < line.size() && line[i] == '}') return true;
+    while (i < line.size()) {
+        string key, value;
+        skip();
+        if (!read_string(key)) return false;
+        skip();
+        if (i >= line.size() || line[i] != ':') return false;
+        i++;
+        skip();
+        if (i < line.size() && line[i] == '"') {
+            if (!read_string(value)) return false;
+        } else {
+            while (i < line.size() && line[i] != ',' && line[i] != '}' &&
+                   !isspace((unsigned char)line[i])) {
+                value += line[i++];
+            }
+            if (value.empty()) return false;
+        }
+        out[key] = value;
+        skip();
+        if (i < line.size() && line[i] == ',') {
+            i++;
+            continue;
+        }
+        if (i < line.size() && line[i] == '}') return true;
+        return false;
+    }
+    return false;
+}
+
+static string Quote(const string& s) {
+    string q = "\"";
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') q += '\\';
+        q += ch;
+    }
+    return q + "\"";
+}
+
+static string Error(const string& id, const string& message) {
+    return "{" + id + "\"ok\":false,\"error\":" + Quote(message) + "}";
+}
+
+static string ScoreFields(const Layout& L) {
+    ScoreParts parts = ComputeScoreParts(L);
+    ostringstream out;
+    out << "\"score\":" << parts.Score(L.inst.params.wC, L.inst.params.wX)
+        << ",\"exposure\":" << parts.exposure
+        << ",\"row_clash\":" << parts.row_clash
+        << ",\"across_clash\":" << parts.across_clash;
+    return out.str();
+}
+
+static shared_ptr<Session> FindSession(SolverServer& server, const string& name) {
+    lock_guard<mutex> lock(server.mu);
+    auto it = server.sessions.find(name);
+    return it == server.sessions.end() ? nullptr : it->second;
+}
+
+static string HandleLoad(SolverServer& server, map<string, string>& req,
+                         const string& id) {
+    if (req["name"].empty()) return Error(id, "load needs a name");
+    const string& file = req["file"];
+    auto session = make_shared<Session>();
+    ParseError err;
+    if (!ParseInstance(file, server.params, session->best.inst, err)) {
+        if (err.line == 0) return Error(id, err.message);
+        return Error(id, file + ":" + to_string(err.line) + ":" +
+                             to_string(err.col) + ": " + err.message);
+    }
+    const Params& p = session->best.inst.params;
+    ostringstream out;
+    out << "{" << id << "\"ok\":true,\"name\":" << Quote(req["name"])
+        << ",\"rows\":" << p.rows << ",\"cols\":" << p.cols
+        << ",\"booths\":" << session->best.inst.booths.size() << "}";
+
+    lock_guard<mutex> lock(server.mu);
+    server.sessions[req["name"]] = session;
+    return out.str();
+}
+
+static string HandleSolve(Session& s, map<string, string>& req, const string& id) {
+    double budget_ms = req.count("budget_ms") ? atof(req["budget_ms"].c_str()) : 0;
+    int iters = req.count("iters") ? atoi(req["iters"].c_str()) : 10000;
+    unsigned seed = req.count("seed") ? (unsigned)atoi(req["seed"].c_str())
+                                      : s.best.inst.params.seed + s.solves;
+
+    auto start = chrono::steady_clock::now();
+    // warm start: the previous best layout, with any unplaced booths added
+    SeedLayout(s.best);
+    LocalSearch(s.best, iters, seed, budget_ms);
+    s.solved = true;
+    s.solves++;
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    ostringstream out;
+    out << "{" << id << "\"ok\":true," << ScoreFields(s.best)
+        << ",\"seed\":" << seed << ",\"ms\":" << elapsed.count() << "}";
+    return out.str();
+}
+
+static string HandleEdit(Session& s, map<string, string>& req, const string& id) {
+    Instance& inst = s.best.inst;
+    if (!req.count("r") || !req.count("c")) {
+        return Error(id, "edit needs a slot r, c inside the grid");
+    }
+    int r = atoi(req["r"].c_str());
+    int c = atoi(req["c"].c_str());
+    if (r < 0 || r >= inst.params.rows || c < 0 || c >= inst.params.cols) {
+        return Error(id, "edit needs a slot r, c inside the grid");
+    }
+    Slot& slot = inst.slots[inst.index(r, c)];
+    const string& op = req["op"];
+
+    if (op == "block") {
+        slot.blocked = true;
+        slot.booth_id = -1; // its booth is placed again on the next solve
+    } else if (op == "unblock") {
+        slot.blocked = false;
+    } else if (op == "bonus") {
+        if (!req.count("value")) return Error(id, "bonus edit needs a value");
+        slot.bonus = atof(req["value"].c_str());
+    } else if (op == "move") {
+        int booth = req.count("booth") ? atoi(req["booth"].c_str()) : -1;
+        if (booth < 0 || booth >= (int)inst.booths.size()) {
+            return Error(id, "move edit needs a valid booth");
+        }
+        if (slot.blocked) return Error(id, "target slot is blocked");
+        int target = inst.index(r, c);
+        if (!inst.Allowed(booth, target)) {
+            return Error(id, "placement rules do not allow the booth there");
+        }
+        // swap with the booth already in the target slot, if any
+        int other = slot.booth_id;
+        bool placed = false;
+        for (size_t i = 0; i < inst.slots.size(); i++) {
+            if (inst.slots[i].booth_id != booth) continue;
+            placed = true;
+            if (other >= 0 && !inst.Allowed(other, i)) {
+                return Error(id, "placement rules do not allow the swapped booth");
+            }
+        }
+        // an unplaced booth has no slot to give the other one
+        if (!placed && other >= 0 && other != booth) {
+            return Error(id, "target slot is taken and the booth is not placed");
+        }
+        for (auto& t : inst.slots) {
+            if (t.booth_id == booth) t.booth_id = other;
+        }
+        slot.booth_id = booth;
+    } else {
+        return Error(id, "unknown edit op " + Quote(op));
+    }
+    return "{" + id + "\"ok\":true," + ScoreFields(s.best) + "}";
+}
+
+static string HandleGet(Session& s, const string& id) {
+    const Instance& inst = s.best.inst;
+    ostringstream out;
+    out << "{" << id << "\"ok\":true,\"solved\":" << (s.solved ? "true" : "false")
+        << "," << ScoreFields(s.best) << ",\"layout\":[";
+    for (int r = 0; r < inst.params.rows; r++) {
+        out << (r ? ",[" : "[");
+        for (int c = 0; c < inst.params.cols; c++) {
+            const Slot& slot = inst.slots[inst.index(r, c)];
+            out << (c ? "," : "") << (slot.blocked ? -2 : slot.booth_id);
+        }
+        out << "]";
+    }
+    out << "]}";
+    return out.str();
+}
+
+string HandleRequest(SolverServer& server, const string& line) {
+    map<string, string> req;
+    if (!ParseRequest(line, req)) return Error("", "malformed request");
+
+    string id = req.count("id") ? "\"id\":" + Quote(req["id"]) + "," : "";
+    const string& cmd = req["cmd"];
+
+    if (cmd == "load") return HandleLoad(server, req, id);
+    if (cmd == "shutdown") {
+        server.stop = true;
+        return "{" + id + "\"ok\":true}";
+    }
+    if (cmd == "unload") {
+        lock_guard<mutex> lock(server.mu);
+        if (!server.sessions.erase(req["name"])) {
+            return Error(id, "no instance " + Quote(req["name"]));
+        }
+        return "{" + id + "\"ok\":true}";
+    }
+
+    shared_ptr<Session> session = FindSession(server, req["name"]);
+    if (!session) return Error(id, "no instance " + Quote(req["name"]));
+    lock_guard<mutex> lock(session->mu);
+    if (cmd == "solve") return HandleSolve(*session, req, id);
+    if (cmd == "edit") return HandleEdit(*session, req, id);
+    if (cmd == "get") return HandleGet(*session, id);
+    return Error(id, "unknown cmd " + Quote(cmd));
+}
+
+int ServeStream(SolverServer& server, istream& in, ostream& out) {
+    string line;
+    while (!server.stop && getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        out << HandleRequest(server, line) << endl;
+    }
+    return 0;
+}
+
+// Read requests from one client until it disconnects or the server stops.
+// The caller closes the descriptor.
+static void ServeConnection(SolverServer& server, int fd, int listen_fd) {
+    string pending;
+    char buf[4096];
+    while (!server.stop) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        pending.append(buf, n);
+
+        size_t nl;
+        while ((nl = pending.find('\n')) != string::npos) {
+            string line = pending.substr(0, nl);
+            pending.erase(0, nl + 1);
+            if (line.find_first_not_of(" \t\r") == string::npos) continue;
+
+            string response = HandleRequest(server, line) + "\n";
+            size_t sent = 0;
+            while (sent < response.size()) {
+                // no SIGPIPE if the client has gone: that would kill the server
+                ssize_t k = send(fd, response.data() + sent, response.size() - sent,
+                                 MSG_NOSIGNAL);
+                if (k <= 0) break;
+                sent += k;
+            }
+            // wake up accept() so the listener notices the shutdown
+            if (server.stop) shutdown(listen_fd, SHUT_RDWR);
+        }
+    }
+}
+
+int ServeUnixSocket(SolverServer& server, const string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: socket path too long: " << path << endl;
+        return 1;
+    }
+    path.copy(addr.sun_path, path.size());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        cerr << "Error: cannot create socket" << endl;
+        return 1;
+    }
+    unlink(path.c_str());
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, 16) < 0) {
+        cerr << "Error: cannot listen on " << path << endl;
+        close(listen_fd);
+        return 1;
+    }
+
+    // Each connection closes its own descriptor when it ends, and finished
+    // threads are joined at the next accept, so a long-running server does
+    // not collect descriptors or threads. open_fds lets the shutdown reach
+    // the clients that are still connected.
+    struct Connection {
+        thread th;
+        shared_ptr<atomic<bool>> finished;
+    };
+    vector<Connection> connections;
+    mutex fds_mu;
+    set<int> open_fds;
+    auto reap = [&]() {
+        for (size_t i = 0; i < connections.size();) {
+            if (*connections[i].finished) {
+                connections[i].th.join();
+                connections[i] = move(connections.back());
+                connections.pop_back();
+            } else {
+                i++;
+            }
+        }
+    };
+    while (!server.stop) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) break;
+        reap();
+        {
+            lock_guard<mutex> lock(fds_mu);
+            open_fds.insert(fd);
+        }
+        auto finished = make_shared<atomic<bool>>(false);
+        thread th([&, fd, finished]() {
+            ServeConnection(server, fd, listen_fd);
+            {
+                lock_guard<mutex> lock(fds_mu);
+                open_fds.erase(fd);
+                close(fd);
+            }
+            *finished = true;
+        });
+        connections.push_back({move(th), finished});
+    }
+    // unblock clients that are still connected
+    {
+        lock_guard<mutex> lock(fds_mu);
+        for (int fd : open_fds) shutdown(fd, SHUT_RDWR);
+    }
+    for (auto& c : connections) c.th.join();
+
+    close(listen_fd);
+    unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "model.h"
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+// An instance kept in memory between requests, together with the best
+// layout found so far, which warm-starts the next solve
+struct Session {
+    mutex mu;
+    Layout best;
+    bool solved = false;
+    unsigned solves = 0;
+};
+
+// Long-running solver state shared by all connections
+struct SolverServer {
+    Params params;
+    mutex mu; // guards sessions; each session has its own lock
+    map<string, shared_ptr<Session>> sessions;
+    atomic<bool> stop{false};
+};
+
+// Handle one line-delimited JSON request and return the JSON response.
+// Requests are flat objects with a "cmd" field:
+//   {"cmd":"load","name":"a","file":"data/greedy_trap.txt"}
+//   {"cmd":"solve","name":"a","budget_ms":200,"seed":1}
+//   {"cmd":"edit","name":"a","op":"block","r":0,"c":1}
+//       op is block, unblock, bonus (with "value") or move (with "booth")
+//   {"cmd":"get","name":"a"}
+//   {"cmd":"unload","name":"a"}
+//   {"cmd":"shutdown"}
+// An "id" field, if present, is echoed back in the response.
+string HandleRequest(SolverServer& server, const string& line);
+
+// Serve requests read line by line from `in`, one at a time
+int ServeStream(SolverServer& server, istream& in, ostream& out);
+
+// Serve requests on a Unix domain socket, one thread per connection, so
+// requests on different instances run concurrently. Returns after a
+// shutdown request.
+int ServeUnixSocket(SolverServer& server, const string& path);
+
+#endif
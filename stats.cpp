@@ -0,0 +1,78 @@
+#include "stats.h"
+#include <sstream>
+#include <time.h>
+
+using namespace std;
+
+SolverStats& ThreadStats() {
+    thread_local SolverStats stats;
+    return stats;
+}
+
+static double ClockMs(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+PhaseTimer::PhaseTimer(PhaseTime& phase)
+    : phase_(phase),
+      wall_start_(ClockMs(CLOCK_MONOTONIC)),
+      cpu_start_(ClockMs(CLOCK_THREAD_CPUTIME_ID)) {}
+
+PhaseTimer::~PhaseTimer() {
+    phase_.wall_ms += ClockMs(CLOCK_MONOTONIC) - wall_start_;
+    phase_.cpu_ms += ClockMs(CLOCK_THREAD_CPUTIME_ID) - cpu_start_;
+}
+
+static void AddPhase(PhaseTime& into, const PhaseTime& from) {
+    into.wall_ms += from.wall_ms;
+    into.cpu_ms += from.cpu_ms;
+}
+
+void AddStats(SolverStats& into, const SolverStats& from) {
+    AddPhase(into.parse, from.parse);
+    AddPhase(into.greedy, from.greedy);
+    AddPhase(into.local_search, from.local_search);
+    AddPhase(into.output, from.output);
+    into.swap_evals += from.swap_evals;
+    into.relocate_evals += from.relocate_evals;
+    into.swap_accepted += from.swap_accepted;
+    into.relocate_accepted += from.relocate_accepted;
+    into.rejected_iters += from.rejected_iters;
+    into.iterations += from.iterations;
+    into.last_improvement_iter = from.last_improvement_iter;
+    into.stopped_by_patience = from.stopped_by_patience;
+}
+
+static void PhaseJson(ostringstream& out, const char* name, const PhaseTime& t) {
+    out << "\"" << name << "\":{\"wall_ms\":" << t.wall_ms
+        << ",\"cpu_ms\":" << t.cpu_ms << "}";
+}
+
+string StatsJson(const SolverStats& s) {
+    long long evals = s.swap_evals + s.relocate_evals;
+    double ls_sec = s.local_search.wall_ms / 1e3;
+
+    ostringstream out;
+    out << "{\"phases\":{";
+    PhaseJson(out, "parse", s.parse);
+    out << ",";
+    PhaseJson(out, "greedy", s.greedy);
+    out << ",";
+    PhaseJson(out, "local_search", s.local_search);
+    out << ",";
+    PhaseJson(out, "output", s.output);
+    out << "},\"local_search\":{"
+        << "\"iterations\":" << s.iterations
+        << ",\"last_improvement_iter\":" << s.last_improvement_iter
+        << ",\"stopped_by_patience\":" << (s.stopped_by_patience ? "true" : "false")
+        << ",\"evals\":{\"swap\":" << s.swap_evals
+        << ",\"relocate\":" << s.relocate_evals << "}"
+        << ",\"accepted\":{\"swap\":" << s.swap_accepted
+        << ",\"relocate\":" << s.relocate_accepted << "}"
+        << ",\"rejected_iters\":" << s.rejected_iters
+        << ",\"evals_per_sec\":" << (ls_sec > 0 ? evals / ls_sec : 0.0)
+        << "}}";
+    return out.str();
+}
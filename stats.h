@@ -0,0 +1,61 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+
+using namespace std;
+
+// Wall and CPU time spent in one phase of a run
+struct PhaseTime {
+    double wall_ms = 0.0;
+    double cpu_ms = 0.0;
+};
+
+// Counters for one solver thread. Only filled in when built with
+// LAYOUT_STATS (the default, `make STATS=0` compiles them out).
+struct SolverStats {
+    PhaseTime parse, greedy, local_search, output;
+
+    long long swap_evals = 0;      // DeltaSwapSlots calls
+    long long relocate_evals = 0;  // DeltaRelocateSlots calls
+    long long swap_accepted = 0;
+    long long relocate_accepted = 0;
+    long long rejected_iters = 0;  // iterations without an improving move
+
+    long long iterations = 0;
+    long long last_improvement_iter = -1;
+    bool stopped_by_patience = false;
+};
+
+// Stats of the calling thread
+SolverStats& ThreadStats();
+
+// Stats as a JSON object
+string StatsJson(const SolverStats& stats);
+
+// Add the counters and phase times of `from` to `into`; the last
+// improvement and patience stop are taken from `from`, the later run
+void AddStats(SolverStats& into, const SolverStats& from);
+
+// Adds the time between construction and destruction to a phase
+class PhaseTimer {
+public:
+    explicit PhaseTimer(PhaseTime& phase);
+    ~PhaseTimer();
+
+private:
+    PhaseTime& phase_;
+    double wall_start_, cpu_start_;
+};
+
+#ifdef LAYOUT_STATS
+#define STATS_ADD(field, n) (ThreadStats().field += (n))
+#define STATS_SET(field, v) (ThreadStats().field = (v))
+#define STATS_PHASE(name) PhaseTimer stats_phase_##name(ThreadStats().name)
+#else
+#define STATS_ADD(field, n) ((void)(n))
+#define STATS_SET(field, v) ((void)(v))
+#define STATS_PHASE(name) ((void)0)
+#endif
+
+#endif
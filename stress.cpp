@@ -0,0 +1,85 @@
+#include "model.h"
+#include "io.h"
+#include "verify.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static const char* NeighborhoodName(Neighborhood n) {
+    switch (n) {
+    case Neighborhood::Four: return "four";
+    case Neighborhood::Diagonal: return "diagonal";
+    case Neighborhood::WideAisle: return "wide";
+    case Neighborhood::BackToBack: return "backtoback";
+    }
+    return "four";
+}
+
+// Check every delta against full rescoring on random instances; on a
+// mismatch, shrink it and write the reproducer
+int main(int argc, char** argv) {
+    StressOptions opt;
+    string out = "stress_fail";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--instances" && has_value) {
+            opt.instances = atoi(argv[++i]);
+        } else if (arg == "--moves" && has_value) {
+            opt.moves = atol(argv[++i]);
+        } else if (arg == "--max-rows" && has_value) {
+            opt.max_rows = atoi(argv[++i]);
+        } else if (arg == "--max-cols" && has_value) {
+            opt.max_cols = atoi(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            opt.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--tolerance" && has_value) {
+            opt.tolerance = atof(argv[++i]);
+        } else if (arg == "--out" && has_value) {
+            out = argv[++i];
+        } else {
+            cerr << "Usage: ./stress [--instances n] [--moves n] [--max-rows n]" << endl;
+            cerr << "                [--max-cols n] [--seed s] [--tolerance t] [--out prefix]" << endl;
+            return 1;
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    StressResult result = RunStress(opt);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << "Stress: " << opt.instances << " instances, " << result.moves << " moves, "
+         << result.full_checks << " full rescores in " << elapsed.count() << " s" << endl;
+    if (!result.failed) {
+        cout << "All deltas match full rescoring" << endl;
+        return 0;
+    }
+
+    StressFailure& f = result.failure;
+    if (f.move.a < 0) {
+        cerr << "Error: instance " << f.instance << " drifted to " << f.delta
+             << " against " << f.expected << " with no single bad move"
+             << " (rounding; try a larger --tolerance)" << endl;
+        return 1;
+    }
+    cerr << "Error: instance " << f.instance << ", move " << f.move_index
+         << ": delta " << f.delta << ", rescoring gives " << f.expected << endl;
+    ShrinkFailure(f, MoveDelta, opt.tolerance);
+
+    const Instance& inst = f.before.inst;
+    const Slot& a = inst.slots[f.move.a];
+    const Slot& b = inst.slots[f.move.b];
+    WriteInstance(out + ".txt", inst);
+    WriteLayout(out + ".layout", f.before);
+    cerr << "Shrunk to " << inst.params.rows << "x" << inst.params.cols << " with "
+         << inst.booths.size() << " booths: "
+         << (b.booth_id >= 0 ? "swap" : "relocate") << " (" << a.r << "," << a.c
+         << ") -> (" << b.r << "," << b.c << "), delta " << f.delta
+         << ", rescoring gives " << f.expected << endl;
+    cerr << "Wrote " << out << ".txt and " << out << ".layout (wC " << inst.params.wC
+         << ", wX " << inst.params.wX << ", --neighborhood "
+         << NeighborhoodName(inst.params.neighborhood) << ")" << endl;
+    return 1;
+}
@@ -0,0 +1,128 @@
+#include "sweep.h"
+#include "greedy.h"
+#include "localsearch.h"
+#include "io.h"
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// Solve one wC row of the grid, left to right over wX. Point j draws from
+// stream first_stream + j of the seed.
+static void SolveChain(const Instance& inst, double wC,
+                       const vector<double>& wX_values, int max_iters,
+                       unsigned seed, size_t first_stream, SweepPoint* out) {
+    for (size_t j = 0; j < wX_values.size(); j++) {
+        double wX = wX_values[j];
+
+        // Warm start: rescore every layout already solved in this chain
+        // under the new weights and start from the best one
+        Layout L;
+        int best_prev = -1;
+        double best_prev_score = 0.0;
+        for (size_t k = 0; k < j; k++) {
+            double s = out[k].parts.Score(wC, wX);
+            if (best_prev < 0 || s > best_prev_score) {
+                best_prev = k;
+                best_prev_score = s;
+            }
+        }
+
+        if (best_prev >= 0) {
+            L = out[best_prev].layout;
+        } else {
+            L.inst = inst;
+        }
+        L.inst.params.wC = wC;
+        L.inst.params.wX = wX;
+        if (best_prev < 0) SeedLayout(L);
+
+        Rng rng(seed, first_stream + j);
+        LocalSearch(L, max_iters, rng);
+
+        out[j].wC = wC;
+        out[j].wX = wX;
+        out[j].parts = ComputeScoreParts(L);
+        out[j].layout = L;
+    }
+}
+
+vector<SweepPoint> WeightSweep(const Instance& inst,
+                               const vector<double>& wC_values,
+                               const vector<double>& wX_values,
+                               int max_iters, unsigned seed, int threads) {
+    size_t rows = wC_values.size();
+    size_t cols = wX_values.size();
+    vector<SweepPoint> points(rows * cols);
+    if (points.empty()) return points;
+
+    // Hand out whole chains so each warm start stays on one thread
+    atomic<size_t> next_row(0);
+    auto worker = [&]() {
+        for (size_t i = next_row++; i < rows; i = next_row++) {
+            SolveChain(inst, wC_values[i], wX_values, max_iters,
+                       seed, i * cols, &points[i * cols]);
+        }
+    };
+
+    if (threads < 1) threads = 1;
+    if ((size_t)threads > rows) threads = rows;
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+
+    MarkPareto(points);
+    return points;
+}
+
+// true if a is at least as good as b everywhere and better somewhere
+static bool Dominates(const ScoreParts& a, const ScoreParts& b) {
+    if (a.exposure < b.exposure) return false;
+    if (a.row_clash > b.row_clash) return false;
+    if (a.across_clash > b.across_clash) return false;
+    return a.exposure > b.exposure || a.row_clash < b.row_clash ||
+           a.across_clash < b.across_clash;
+}
+
+void MarkPareto(vector<SweepPoint>& points) {
+    for (size_t i = 0; i < points.size(); i++) {
+        points[i].pareto = true;
+        for (size_t j = 0; j < points.size() && points[i].pareto; j++) {
+            if (i == j) continue;
+            const ScoreParts& a = points[j].parts;
+            const ScoreParts& b = points[i].parts;
+            if (Dominates(a, b)) points[i].pareto = false;
+            // keep only the first of several identical trade-offs
+            if (j < i && a.exposure == b.exposure && a.row_clash == b.row_clash &&
+                a.across_clash == b.across_clash) {
+                points[i].pareto = false;
+            }
+        }
+    }
+}
+
+void PrintSweep(const vector<SweepPoint>& points) {
+    cout << "   wC    wX     Score  Exposure  Row  Across  Pareto" << endl;
+    for (const auto& p : points) {
+        cout << fixed << setprecision(2)
+             << setw(5) << p.wC << " " << setw(5) << p.wX << " "
+             << setw(9) << p.parts.Score(p.wC, p.wX) << " "
+             << setw(9) << p.parts.exposure << " "
+             << setw(4) << p.parts.row_clash << " "
+             << setw(7) << p.parts.across_clash << "  "
+             << (p.pareto ? "*" : "") << endl;
+    }
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+
+    cout << "\nPareto layouts (exposure, row clashes, across clashes):" << endl;
+    for (const auto& p : points) {
+        if (!p.pareto) continue;
+        cout << "\n(" << p.parts.exposure << ", " << p.parts.row_clash << ", "
+             << p.parts.across_clash << ") at wC=" << p.wC << " wX=" << p.wX << endl;
+        PrintLayout(p.layout);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "model.h"
+#include "score.h"
+#include <vector>
+
+using namespace std;
+
+// One solved point of a weight sweep
+struct SweepPoint {
+    double wC, wX;
+    ScoreParts parts;
+    Layout layout;
+    bool pareto = false; // not dominated on (exposure, row, across)
+};
+
+// Solve every (wC, wX) pair of the grid. Each wC row is a chain over the
+// wX values where every point warm-starts from the best layout found so far
+// in its chain. Rows are independent and run on up to `threads` threads.
+vector<SweepPoint> WeightSweep(const Instance& inst,
+                               const vector<double>& wC_values,
+                               const vector<double>& wX_values,
+                               int max_iters, unsigned seed, int threads);
+
+// Mark the points that are not dominated by any other point
+void MarkPareto(vector<SweepPoint>& points);
+
+// Print the sweep table and the layouts of the Pareto points
+void PrintSweep(const vector<SweepPoint>& points);
+
+#endif
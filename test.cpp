@@ -2,9 +2,29 @@
 #include "io.h"
 #include "score.h"
 #include "greedy.h"
+#include "sweep.h"
+#include "batch.h"
+#include "server.h"
+#include "binio.h"
+#include "generator.h"
+#include "localsearch.h"
+#include "stats.h"
+#include "trace.h"
+#include "hall.h"
+#include "output.h"
+#include "rng.h"
+#include "verify.h"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 using namespace std;
 
@@ -161,6 +181,916 @@ void test_greedy_best_slot() {
     cout << "Test 5 passed: Greedy places booth in best slot" << endl;
 }
 
+// Test 6: Weight sweep caches correct score parts and finds a Pareto front
+void test_weight_sweep() {
+    Params params;
+    Instance inst = ReadInstance("data/greedy_trap.txt", params);
+    vector<double> wC = {0.0, 0.6, 1.2};
+    vector<double> wX = {0.0, 0.3};
+    vector<SweepPoint> points = WeightSweep(inst, wC, wX, 200, 42, 2);
+    assert(points.size() == 6);
+
+    int pareto = 0;
+    for (const auto& p : points) {
+        // cached parts rescore to the same value as a full recompute
+        double full = ComputeTotalScore(p.layout);
+        assert(fabs(p.parts.Score(p.wC, p.wX) - full) < 1e-9);
+        if (p.pareto) pareto++;
+    }
+    assert(pareto >= 1);
+    cout << "Test 6 passed: Weight sweep" << endl;
+}
+
+// Test 7: Batch mode solves every instance and reports each one in order
+void test_batch() {
+    Params params;
+    params.seed = 7;
+    vector<string> files = ListBatchFiles("data");
+    assert(files.size() >= 3);
+    size_t dup = files.size();
+    files.push_back("./data/small1.txt"); // same stem as data/small1.txt
+    files.push_back("data/missing.txt");
+
+    vector<BatchResult> results = RunBatch(files, "batch_out", params, 100, 2, 1);
+    assert(results.size() == files.size());
+    for (size_t i = 0; i + 1 < results.size(); i++) {
+        assert(results[i].ok);
+        assert(results[i].file == files[i]);
+        assert(results[i].seed == 7 + i);
+        assert(results[i].score > 0.0);
+    }
+    assert(!results.back().ok);
+
+    // same stems get the index appended, and the summary is in input order
+    ifstream dup_layout("batch_out/small1." + to_string(dup) + ".layout");
+    assert(dup_layout.good());
+    ifstream summary("batch_out/summary.csv");
+    string row;
+    getline(summary, row);
+    for (size_t i = 0; i < files.size(); i++) {
+        assert(getline(summary, row));
+        assert(row.rfind(to_string(i) + ",", 0) == 0);
+    }
+    cout << "Test 7 passed: Batch solving" << endl;
+}
+
+// Test 8: Server requests keep instances and warm layouts in memory
+void test_server_requests() {
+    SolverServer server;
+    string r = HandleRequest(server,
+        "{\"cmd\":\"load\",\"name\":\"trap\",\"file\":\"data/greedy_trap.txt\",\"id\":7}");
+    assert(r.find("\"ok\":true") != string::npos);
+    assert(r.find("\"id\":\"7\"") != string::npos);
+    assert(r.find("\"rows\":3") != string::npos);
+
+    r = HandleRequest(server, "{\"cmd\":\"solve\",\"name\":\"trap\",\"iters\":50,\"seed\":1}");
+    assert(r.find("\"ok\":true") != string::npos);
+    Layout solved = server.sessions["trap"]->best;
+    for (size_t b = 0; b < solved.inst.booths.size(); b++) {
+        int count = 0;
+        for (const auto& s : solved.inst.slots) {
+            if (s.booth_id == (int)b) count++;
+        }
+        assert(count == 1);
+    }
+
+    // blocking an occupied slot unplaces its booth until the next solve
+    r = HandleRequest(server, "{\"cmd\":\"edit\",\"name\":\"trap\",\"op\":\"block\",\"r\":1,\"c\":3}");
+    assert(r.find("\"ok\":true") != string::npos);
+    r = HandleRequest(server, "{\"cmd\":\"solve\",\"name\":\"trap\",\"budget_ms\":50}");
+    Layout& L = server.sessions["trap"]->best;
+    assert(L.inst.slots[L.inst.index(1, 3)].booth_id == -1);
+    int placed = 0;
+    for (const auto& s : L.inst.slots) {
+        if (s.booth_id >= 0) placed++;
+    }
+    assert(placed == 12);
+
+    // an edit needs its slot; the keys are not defaulted to (0, 0)
+    r = HandleRequest(server, "{\"cmd\":\"edit\",\"name\":\"trap\",\"op\":\"block\"}");
+    assert(r.find("\"ok\":false") != string::npos);
+    r = HandleRequest(server, "{\"cmd\":\"edit\",\"name\":\"trap\",\"op\":\"block\",\"r\":0}");
+    assert(r.find("\"ok\":false") != string::npos);
+    assert(!L.inst.slots[0].blocked);
+
+    // a booth unplaced by a block cannot take an occupied slot, which
+    // would drop that slot's booth from the layout
+    vector<int> occupied;
+    for (size_t i = 0; i < L.inst.slots.size(); i++) {
+        if (L.inst.slots[i].booth_id >= 0) occupied.push_back(i);
+    }
+    assert(occupied.size() >= 2);
+    const Slot& b = L.inst.slots[occupied[0]];
+    int unplaced = b.booth_id;
+    r = HandleRequest(server, "{\"cmd\":\"edit\",\"name\":\"trap\",\"op\":\"block\",\"r\":" +
+                                  to_string(b.r) + ",\"c\":" + to_string(b.c) + "}");
+    assert(r.find("\"ok\":true") != string::npos);
+    int taken = occupied[1];
+    int holder = L.inst.slots[taken].booth_id;
+    const Slot& t = L.inst.slots[taken];
+    r = HandleRequest(server, "{\"cmd\":\"edit\",\"name\":\"trap\",\"op\":\"move\",\"r\":" +
+                                  to_string(t.r) + ",\"c\":" + to_string(t.c) +
+                                  ",\"booth\":" + to_string(unplaced) + "}");
+    assert(r.find("\"ok\":false") != string::npos);
+    assert(L.inst.slots[taken].booth_id == holder);
+
+    // a load needs a session name
+    r = HandleRequest(server, "{\"cmd\":\"load\",\"file\":\"data/greedy_trap.txt\"}");
+    assert(r.find("\"ok\":false") != string::npos);
+    assert(!server.sessions.count(""));
+
+    r = HandleRequest(server, "{\"cmd\":\"get\",\"name\":\"trap\"}");
+    assert(r.find("\"layout\":[[") != string::npos);
+    r = HandleRequest(server, "{\"cmd\":\"get\",\"name\":\"nope\"}");
+    assert(r.find("\"ok\":false") != string::npos);
+    r = HandleRequest(server, "not json");
+    assert(r.find("\"ok\":false") != string::npos);
+    cout << "Test 8 passed: Server requests" << endl;
+}
+
+// Send one request line over a connected socket and read the response line
+static string SocketRequest(int fd, const string& line) {
+    string msg = line + "\n";
+    assert(send(fd, msg.data(), msg.size(), 0) == (ssize_t)msg.size());
+    string response;
+    char ch;
+    while (recv(fd, &ch, 1, 0) == 1 && ch != '\n') response += ch;
+    return response;
+}
+
+static int ConnectUnix(const string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    path.copy(addr.sun_path, path.size());
+    for (int attempt = 0; attempt < 200; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+        close(fd);
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+// Test 9: Local client solves two instances concurrently over a Unix socket
+void test_server_socket() {
+    string path = "/tmp/layout_test_" + to_string(getpid()) + ".sock";
+    SolverServer server;
+    thread serve([&]() { ServeUnixSocket(server, path); });
+
+    auto client = [&](string name, string file, bool* ok) {
+        int fd = ConnectUnix(path);
+        assert(fd >= 0);
+        string r = SocketRequest(fd, "{\"cmd\":\"load\",\"name\":\"" + name +
+                                     "\",\"file\":\"" + file + "\"}");
+        bool loaded = r.find("\"ok\":true") != string::npos;
+        r = SocketRequest(fd, "{\"cmd\":\"solve\",\"name\":\"" + name +
+                              "\",\"budget_ms\":100,\"seed\":3}");
+        bool solved = r.find("\"score\":") != string::npos;
+        r = SocketRequest(fd, "{\"cmd\":\"get\",\"name\":\"" + name + "\"}");
+        *ok = loaded && solved && r.find("\"solved\":true") != string::npos;
+        close(fd);
+    };
+    bool ok_a = false, ok_b = false;
+    thread a(client, "a", "data/greedy_trap.txt", &ok_a);
+    thread b(client, "b", "data/small1.txt", &ok_b);
+    a.join();
+    b.join();
+    assert(ok_a && ok_b);
+
+    // a client that hangs up before its reply must not take the server down
+    int gone = ConnectUnix(path);
+    string req = "{\"cmd\":\"solve\",\"name\":\"a\",\"budget_ms\":50}\n";
+    assert(send(gone, req.data(), req.size(), 0) == (ssize_t)req.size());
+    close(gone);
+    usleep(100000);
+    int fd = ConnectUnix(path);
+    assert(SocketRequest(fd, "{\"cmd\":\"get\",\"name\":\"b\"}").find("\"ok\":true") !=
+           string::npos);
+
+    assert(SocketRequest(fd, "{\"cmd\":\"shutdown\"}").find("\"ok\":true") != string::npos);
+    serve.join();
+    close(fd);
+    cout << "Test 9 passed: Server over Unix socket" << endl;
+}
+
+// Test 10: Parser skips comments and reports errors with line and column
+void test_parse_errors() {
+    Params params;
+    Instance inst;
+    ParseError err;
+
+    string good = "# grid\n  2 2\n\n1\n  # booth\n0 Food 5\n0\n0.1 0.2\n0.3 0.4\n";
+    assert(ParseInstanceText(good.data(), good.size(), params, inst, err));
+    assert(inst.booths[0].category == "Food");
+    assert(inst.slots[inst.index(1, 1)].bonus == 0.4);
+
+    string bad_bonus = "2 2\n1\n0 Food 5\n0\n0.1 0.2\n0.3 abc\n";
+    assert(!ParseInstanceText(bad_bonus.data(), bad_bonus.size(), params, inst, err));
+    assert(err.line == 6 && err.col == 5);
+
+    string short_row = "2 2\n1\n0 Food 5\n0\n0.1\n";
+    assert(!ParseInstanceText(short_row.data(), short_row.size(), params, inst, err));
+    assert(err.line == 5 && err.col == 4);
+
+    string outside = "2 2\n0\n1\n# blocked\n5 0\n";
+    assert(!ParseInstanceText(outside.data(), outside.size(), params, inst, err));
+    assert(err.line == 5 && err.col == 1);
+
+    string huge = "50000 50000\n0\n0\n";
+    assert(!ParseInstanceText(huge.data(), huge.size(), params, inst, err));
+    assert(err.line == 1 && err.col == 1 && err.message.rfind("grid too large", 0) == 0);
+
+    string negative_blocked = "1 1\n0\n -3\n0.5\n";
+    assert(!ParseInstanceText(negative_blocked.data(), negative_blocked.size(), params,
+                              inst, err));
+    assert(err.line == 3 && err.col == 2 && err.message == "negative blocked count");
+
+    // a leading '+' parses as it did with istringstream
+    string plus = "1 2\n1\n0 Food +5\n0\n+0.1 0.2\n";
+    assert(ParseInstanceText(plus.data(), plus.size(), params, inst, err));
+    assert(inst.booths[0].value == 5 && inst.slots[0].bonus == 0.1);
+    string plus_minus = "1 2\n1\n0 Food +-5\n0\n0.1 0.2\n";
+    assert(!ParseInstanceText(plus_minus.data(), plus_minus.size(), params, inst, err));
+    assert(err.line == 3 && err.col == 8 && err.message == "bad booth value '+-5'");
+
+    string truncated = "2 2\n3\n0 Food 5\n";
+    assert(!ParseInstanceText(truncated.data(), truncated.size(), params, inst, err));
+    assert(err.message == "missing booth data");
+
+    assert(!ParseInstance("data/missing.txt", params, inst, err));
+    assert(err.line == 0);
+    cout << "Test 10 passed: Parse errors" << endl;
+}
+
+// Test 11: Binary format round-trips instances and layouts
+void test_binary_roundtrip() {
+    Params params;
+    Layout layout;
+    layout.inst = ReadInstance("data/greedy_trap.txt", params);
+    GreedySeed(layout);
+    string file = "/tmp/layout_test_" + to_string(getpid()) + ".bin";
+    assert(WriteBinaryInstance(file, layout.inst, true, false));
+
+    {
+        MappedBinary mapped;
+        ParseError err;
+        assert(MapBinaryInstance(file, mapped, err));
+        const BinaryInstanceView& v = mapped.view;
+        assert(v.rows == 3 && v.cols == 6 && v.num_booths == 12);
+        assert(v.num_categories == 2);
+        assert(v.Category(v.booths[3].category) == "Tech");
+        assert(v.Blocked(layout.inst.index(1, 2)));
+        assert(v.Bonus(layout.inst.index(1, 3)) == 1.0);
+        assert(v.assignment != nullptr);
+        assert((uintptr_t)v.bonus64 % 64 == 0);
+    }
+
+    // ParseInstance picks up the binary format by itself
+    Layout loaded;
+    ParseError err;
+    assert(ParseInstance(file, params, loaded.inst, err));
+    for (size_t i = 0; i < layout.inst.slots.size(); i++) {
+        assert(loaded.inst.slots[i].booth_id == layout.inst.slots[i].booth_id);
+        assert(loaded.inst.slots[i].bonus == layout.inst.slots[i].bonus);
+    }
+    assert(ComputeTotalScore(loaded) == ComputeTotalScore(layout));
+
+    // float32 bonuses, no assignment
+    assert(WriteBinaryInstance(file, layout.inst, false, true));
+    assert(ParseInstance(file, params, loaded.inst, err));
+    assert(fabs(loaded.inst.slots[7].bonus - layout.inst.slots[7].bonus) < 1e-6);
+    assert(loaded.inst.slots[7].booth_id == -1);
+
+    // header dimensions are capped and checked against the file size
+    {
+        ifstream in(file, ios::binary);
+        string image((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        BinaryInstanceView v;
+        assert(ViewBinaryInstance(image.data(), image.size(), v, err));
+        string bad = image;
+        ((BinHeader*)&bad[0])->rows = 1 << 20;
+        ((BinHeader*)&bad[0])->cols = 1 << 20;
+        assert(!ViewBinaryInstance(bad.data(), bad.size(), v, err));
+        assert(err.message.find("grid too large") == 0);
+        bad = image;
+        ((BinHeader*)&bad[0])->num_booths = 0x7fffffff;
+        assert(!ViewBinaryInstance(bad.data(), bad.size(), v, err));
+        bad = image;
+        ((BinHeader*)&bad[0])->num_categories = 0x7fffffff;
+        assert(!ViewBinaryInstance(bad.data(), bad.size(), v, err));
+    }
+
+    // a truncated file is rejected, not read out of bounds
+    assert(truncate(file.c_str(), 100) == 0);
+    assert(!ParseInstance(file, params, loaded.inst, err));
+    remove(file.c_str());
+    cout << "Test 11 passed: Binary format" << endl;
+}
+
+// Test 12: Generator is deterministic and respects its parameters
+void test_generator() {
+    GenParams g;
+    g.rows = 20;
+    g.cols = 30;
+    g.fill = 0.5;
+    g.categories = 3;
+    g.blocked = 0.1;
+    g.values = ValueDist::Heavy;
+    g.bonus = BonusPattern::Entrance;
+    g.seed = 99;
+    Instance a = GenerateInstance(g, Params());
+    Instance b = GenerateInstance(g, Params());
+
+    assert(a.params.rows == 20 && a.params.cols == 30);
+    assert(a.booths.size() == b.booths.size());
+    int free_slots = 0;
+    for (size_t i = 0; i < a.slots.size(); i++) {
+        assert(a.slots[i].blocked == b.slots[i].blocked);
+        assert(a.slots[i].bonus == b.slots[i].bonus);
+        if (!a.slots[i].blocked) free_slots++;
+    }
+    assert((int)a.booths.size() == free_slots / 2);
+    for (size_t i = 0; i < a.booths.size(); i++) {
+        assert(a.booths[i].category == b.booths[i].category);
+        assert(a.booths[i].value == b.booths[i].value);
+        assert(a.booths[i].category == "Food" || a.booths[i].category == "Tech" ||
+               a.booths[i].category == "Apparel");
+    }
+    // entrance pattern: front row beats back row
+    assert(a.slots[a.index(0, 0)].bonus > a.slots[a.index(19, 0)].bonus);
+
+    g.seed = 100;
+    Instance c = GenerateInstance(g, Params());
+    bool differs = c.booths.size() != a.booths.size();
+    for (size_t i = 0; i < a.slots.size() && !differs; i++) {
+        differs = a.slots[i].blocked != c.slots[i].blocked;
+    }
+    assert(differs);
+    cout << "Test 12 passed: Instance generator" << endl;
+}
+
+// Test 13: Local search counters add up
+void test_search_stats() {
+#ifdef LAYOUT_STATS
+    Params params;
+    Layout layout;
+    layout.inst = ReadInstance("data/greedy_trap.txt", params);
+    GreedySeed(layout);
+
+    ThreadStats() = SolverStats();
+    {
+        STATS_PHASE(local_search);
+        LocalSearch(layout, 50, 1);
+    }
+    const SolverStats& s = ThreadStats();
+    assert(s.iterations == 50);
+    assert(s.swap_evals > 0 && s.relocate_evals > 0);
+    long long accepted = s.swap_accepted + s.relocate_accepted;
+    assert(accepted + s.rejected_iters == s.iterations);
+    assert(accepted == 0 || s.last_improvement_iter >= 0);
+    assert(!s.stopped_by_patience);
+    assert(s.local_search.wall_ms > 0.0);
+    assert(StatsJson(s).find("\"iterations\":50") != string::npos);
+    cout << "Test 13 passed: Search stats" << endl;
+#else
+    cout << "Test 13 skipped: built without stats" << endl;
+#endif
+}
+
+// Test 14: Trace ring keeps the newest points and local search records progress
+void test_trace() {
+    TraceRing ring(4);
+    for (int i = 0; i < 10; i++) {
+        ring.Record(TracePoint{0.0, i, 0.0, 0.0, 0, 0, 0});
+    }
+    vector<TracePoint> points;
+    ring.Snapshot(points);
+    assert(points.size() == 4);
+    assert(points.front().iter == 6 && points.back().iter == 9);
+
+    Params params;
+    Layout layout;
+    layout.inst = ReadInstance("data/super_tight.txt", params);
+    GreedySeed(layout);
+    double start_score = ComputeTotalScore(layout);
+
+    StartTrace(1024);
+    LocalSearch(layout, 20, 42);
+    string file = "/tmp/layout_trace_" + to_string(getpid()) + ".csv";
+    assert(FlushTraceCsv(file));
+    StopTrace();
+    assert(ThreadTrace() == nullptr);
+
+    ifstream in(file);
+    string header, line, last;
+    getline(in, header);
+    assert(header == "thread,t_ms,iter,score,best,row_clash,across_clash,move");
+    int rows = 0;
+    while (getline(in, line)) {
+        rows++;
+        last = line;
+    }
+    assert(rows >= 2); // the start point and at least one improvement
+    // the last point is the final score
+    double final_score = ComputeTotalScore(layout);
+    assert(final_score > start_score);
+    size_t p = 0;
+    for (int field = 0; field < 3; field++) p = last.find(',', p) + 1;
+    assert(fabs(atof(last.c_str() + p) - final_score) < 1e-6);
+    // the clash totals are kept from the moves and match a full count
+    for (int field = 3; field < 5; field++) p = last.find(',', p) + 1;
+    assert(fabs(atof(last.c_str() + p) - ComputeRowClash(layout)) < 1e-6);
+    p = last.find(',', p) + 1;
+    assert(fabs(atof(last.c_str() + p) - ComputeAcrossAisleClash(layout)) < 1e-6);
+    remove(file.c_str());
+    cout << "Test 14 passed: Convergence trace" << endl;
+}
+
+// Build a rows x cols layout from a string of categories ('.' = empty)
+static Layout GridLayout(int rows, int cols, const string& cats) {
+    Layout L;
+    L.inst.params.rows = rows;
+    L.inst.params.cols = cols;
+    L.inst.slots.resize(rows * cols);
+    for (int i = 0; i < rows * cols; i++) {
+        L.inst.slots[i].r = i / cols;
+        L.inst.slots[i].c = i % cols;
+        L.inst.slots[i].bonus = 0.5;
+        if (cats[i] == '.') continue;
+        int id = L.inst.booths.size();
+        L.inst.booths.push_back(Booth{id, string(1, cats[i]), 10});
+        L.inst.slots[i].booth_id = id;
+    }
+    CompileInstance(L.inst);
+    return L;
+}
+
+// Test 15: Every neighborhood policy gives deltas that match full rescoring
+void test_neighborhood_policies() {
+    // diagonal pairs only clash with the diagonal policy
+    Layout d = GridLayout(2, 2, "AB" "BA");
+    assert(ComputeAcrossAisleClash(d) == 0);
+    d.inst.params.neighborhood = Neighborhood::Diagonal;
+    assert(ComputeAcrossAisleClash(d) == 2);
+
+    // rows 0/1 share a back wall, rows 1/2 face each other
+    Layout b = GridLayout(3, 1, "A" "A" "A");
+    assert(ComputeAcrossAisleClash(b) == 2);
+    b.inst.params.neighborhood = Neighborhood::BackToBack;
+    assert(ComputeAcrossAisleClash(b) == 1);
+
+    Layout w = GridLayout(3, 1, "A" "B" "A");
+    w.inst.params.neighborhood = Neighborhood::WideAisle;
+    assert(ComputeAcrossAisleClash(w) == 1);
+
+    for (Neighborhood n : {Neighborhood::Four, Neighborhood::Diagonal,
+                           Neighborhood::WideAisle, Neighborhood::BackToBack}) {
+        GenParams g;
+        g.rows = 6;
+        g.cols = 7;
+        g.fill = 0.75;
+        g.categories = 2;
+        g.seed = 5;
+        Layout L;
+        L.inst = GenerateInstance(g, Params());
+        L.inst.params.neighborhood = n;
+        GreedyValueOnly(L);
+
+        mt19937 rng(11);
+        int total = L.inst.slots.size();
+        for (int k = 0; k < 400; k++) {
+            int a = rng() % total, c = rng() % total;
+            Slot& sa = L.inst.slots[a];
+            Slot& sc = L.inst.slots[c];
+            if (a == c || sa.booth_id < 0 || sc.blocked) continue;
+            double before = ComputeTotalScore(L);
+            double delta = sc.booth_id >= 0 ? DeltaSwapSlots(L, a, c)
+                                            : DeltaRelocateSlots(L, a, c);
+            swap(sa.booth_id, sc.booth_id);
+            assert(fabs(ComputeTotalScore(L) - before - delta) < 1e-9);
+        }
+
+        // placement gain is the score change of placing a booth
+        for (int i = 0; i < total; i++) {
+            int bid = L.inst.slots[i].booth_id;
+            if (bid < 0) continue;
+            L.inst.slots[i].booth_id = -1;
+            double before = ComputeTotalScore(L);
+            double gain = PlacementGain(L, bid, i);
+            L.inst.slots[i].booth_id = bid;
+            assert(fabs(ComputeTotalScore(L) - before - gain) < 1e-9);
+        }
+    }
+    cout << "Test 15 passed: Neighborhood policies" << endl;
+}
+
+// Test 16: Category conflict table from the instance file
+void test_category_conflicts() {
+    Params params;
+    Instance inst;
+    ParseError err;
+    string text = "1 4\n4\n0 Coffee 10\n1 Bakery 10\n2 Books 10\n3 Games 10\n0\n"
+                  "1 1 1 1\n"
+                  "# category conflicts\n2\nCoffee Bakery 0.5\nBooks Games -0.25\n";
+    assert(ParseInstanceText(text.data(), text.size(), params, inst, err));
+    assert(inst.conflicts.size() == 2);
+    assert(inst.categories.size() == 4);
+
+    Layout L;
+    L.inst = inst;
+    for (int i = 0; i < 4; i++) L.inst.slots[i].booth_id = i;
+    // Coffee|Bakery costs 0.5, Bakery|Books nothing, Books|Games is a reward
+    assert(fabs(ComputeRowClash(L) - 0.25) < 1e-12);
+    assert(fabs(ComputeTotalScore(L) - (40 - 0.6 * 0.25)) < 1e-12);
+
+    // Coffee Games Books Bakery: only the reward is left
+    swap(L.inst.slots[1].booth_id, L.inst.slots[3].booth_id);
+    assert(fabs(ComputeRowClash(L) + 0.25) < 1e-12);
+
+    // deltas agree with full rescoring under a random table
+    GenParams g;
+    g.rows = 6;
+    g.cols = 7;
+    g.fill = 0.75;
+    g.categories = 4;
+    g.seed = 9;
+    Layout R;
+    R.inst = GenerateInstance(g, params);
+    R.inst.conflicts = {{"Food", "Tech", 0.7}, {"Apparel", "Books", -0.4},
+                        {"Food", "Food", 2.0}};
+    CompileInstance(R.inst);
+    GreedySeed(R);
+    mt19937 rng(3);
+    int total = R.inst.slots.size();
+    for (int k = 0; k < 400; k++) {
+        int a = rng() % total, c = rng() % total;
+        Slot& sa = R.inst.slots[a];
+        Slot& sc = R.inst.slots[c];
+        if (a == c || sa.booth_id < 0 || sc.blocked) continue;
+        double before = ComputeTotalScore(R);
+        double delta = sc.booth_id >= 0 ? DeltaSwapSlots(R, a, c)
+                                        : DeltaRelocateSlots(R, a, c);
+        swap(sa.booth_id, sc.booth_id);
+        assert(fabs(ComputeTotalScore(R) - before - delta) < 1e-9);
+    }
+
+    // conflicts survive the text and binary formats
+    string file = "/tmp/layout_test_" + to_string(getpid());
+    for (string ext : {".txt", ".bin"}) {
+        bool ok = ext == ".txt" ? WriteInstance(file + ext, R.inst)
+                                : WriteBinaryInstance(file + ext, R.inst, true, false);
+        assert(ok);
+        Layout back;
+        assert(ParseInstance(file + ext, params, back.inst, err));
+        assert(back.inst.conflicts.size() == 3);
+        assert(back.inst.conflict == R.inst.conflict);
+        if (ext == ".bin") assert(ComputeTotalScore(back) == ComputeTotalScore(R));
+        remove((file + ext).c_str());
+    }
+
+    // no table without conflicts, and none past kDenseConflictIds: the
+    // same-category rule and the declared pairs are used instead
+    Layout plain = GridLayout(1, 3, "AAB");
+    assert(plain.inst.conflict.empty());
+    assert(ComputeRowClash(plain) == 1.0);
+    int wide = kDenseConflictIds + 10;
+    Layout W;
+    W.inst.params.rows = 1;
+    W.inst.params.cols = wide;
+    W.inst.slots.resize(wide);
+    for (int i = 0; i < wide; i++) {
+        W.inst.slots[i] = Slot{0, i, 1.0};
+        W.inst.slots[i].booth_id = i;
+        W.inst.booths.push_back(Booth{i, "c" + to_string(i == 3 ? 2 : i), 1.0});
+    }
+    W.inst.conflicts = {{"c1", "c0", 0.5}, {"c5", "c6", -0.25}};
+    CompileInstance(W.inst);
+    assert(W.inst.conflict.empty() && W.inst.sparse_conflict.size() == 2);
+    // c0|c1 0.5, c2|c2 1, c5|c6 -0.25
+    assert(fabs(ComputeRowClash(W) - 1.25) < 1e-12);
+    double before = ComputeTotalScore(W);
+    double delta = DeltaSwapSlots(W, 1, wide - 1);
+    swap(W.inst.slots[1].booth_id, W.inst.slots[wide - 1].booth_id);
+    assert(fabs(ComputeTotalScore(W) - before - delta) < 1e-9);
+    assert(fabs(ComputeRowClash(W) - 0.75) < 1e-12);
+    cout << "Test 16 passed: Category conflicts" << endl;
+}
+
+// true if every placed booth sits in a slot its rules allow
+static bool RulesHold(const Layout& L) {
+    for (size_t i = 0; i < L.inst.slots.size(); i++) {
+        int b = L.inst.slots[i].booth_id;
+        if (b >= 0 && !L.inst.Allowed(b, i)) return false;
+    }
+    return true;
+}
+
+// Test 17: Placement rules hold through greedy, local search and sweeps
+void test_placement_rules() {
+    Params params;
+    Layout L;
+    L.inst = ReadInstance("data/constrained.txt", params);
+    assert(L.inst.rules.size() == 4);
+    const Instance& inst = L.inst;
+    assert(inst.Allowed(0, inst.index(3, 0)) && !inst.Allowed(0, inst.index(3, 1)));
+    assert(inst.Allowed(2, inst.index(1, 1)) && !inst.Allowed(2, inst.index(1, 4)));
+    assert(!inst.Allowed(6, inst.index(0, 5)) && inst.Allowed(6, inst.index(1, 5)));
+    assert(inst.Allowed(9, inst.index(0, 5)));
+
+    GreedySeed(L);
+    assert(L.inst.slots[L.inst.index(3, 0)].booth_id == 0);
+    assert(L.inst.slots[L.inst.index(3, 7)].booth_id == 1);
+    assert(RulesHold(L));
+    LocalSearch(L, 500, 7);
+    assert(RulesHold(L));
+
+    vector<SweepPoint> points = WeightSweep(L.inst, {0.0, 1.5}, {0.0, 1.5}, 200, 3, 2);
+    for (const auto& p : points) assert(RulesHold(p.layout));
+
+    // the server refuses manual moves that break a rule
+    SolverServer server;
+    HandleRequest(server,
+        "{\"cmd\":\"load\",\"name\":\"c\",\"file\":\"data/constrained.txt\"}");
+    HandleRequest(server, "{\"cmd\":\"solve\",\"name\":\"c\",\"iters\":50}");
+    string r = HandleRequest(server,
+        "{\"cmd\":\"edit\",\"name\":\"c\",\"op\":\"move\",\"booth\":2,\"r\":0,\"c\":6}");
+    assert(r.find("\"ok\":false") != string::npos);
+    assert(RulesHold(server.sessions["c"]->best));
+
+    // rules survive the text and binary formats
+    string file = "/tmp/layout_test_" + to_string(getpid());
+    for (string ext : {".txt", ".bin"}) {
+        bool ok = ext == ".txt" ? WriteInstance(file + ext, L.inst)
+                                : WriteBinaryInstance(file + ext, L.inst, false, false);
+        assert(ok);
+        Instance back;
+        ParseError err;
+        assert(ParseInstance(file + ext, params, back, err));
+        assert(back.rules.size() == 4);
+        assert(back.booth_mask == L.inst.booth_mask && back.allowed == L.inst.allowed);
+        remove((file + ext).c_str());
+    }
+
+    Instance bad;
+    ParseError err;
+    string text = "1 2\n1\n0 Food 5\n0\n1 1\n0\n1\nbooth 3 allow 0 0 0 0\n";
+    assert(!ParseInstanceText(text.data(), text.size(), params, bad, err));
+    assert(err.line == 8 && err.message == "rule for an unknown booth");
+    cout << "Test 17 passed: Placement rules" << endl;
+}
+
+// Test 18: Multi-hall events place every booth once and respect hall rules
+void test_multi_hall() {
+    Params params;
+    assert(IsEventFile("data/two_halls.txt"));
+    assert(!IsEventFile("data/greedy_trap.txt"));
+    Event event = ReadEvent("data/two_halls.txt", params);
+    assert(event.halls.size() == 2);
+    assert(event.halls[1].params.cols == 6);
+    // coffee is only allowed in hall 1, so it is forbidden in all of hall 0
+    assert(!event.halls[0].Allowed(10, 0) && event.halls[1].Allowed(10, 0));
+    assert(!event.halls[1].Allowed(10, event.halls[1].index(1, 0)));
+
+    EventResult result = SolveEvent(event, 2000, 5, 4);
+    assert(result.rounds >= 1 && result.rounds <= 4);
+    vector<int> seen(event.halls[0].booths.size(), 0);
+    double total = 0.0;
+    for (const auto& L : result.halls) {
+        assert(RulesHold(L));
+        total += ComputeTotalScore(L);
+        for (const auto& s : L.inst.slots) {
+            if (s.booth_id >= 0) seen[s.booth_id]++;
+        }
+    }
+    for (int count : seen) assert(count == 1);
+    assert(result.unplaced.empty());
+    assert(fabs(total - result.score) < 1e-9);
+    // the layouts come back with their own rules, not the hall ownership
+    for (size_t h = 0; h < result.halls.size(); h++) {
+        assert(result.halls[h].inst.booth_mask == event.halls[h].booth_mask);
+        assert(result.halls[h].inst.allowed == event.halls[h].allowed);
+    }
+    const Layout& hall0 = result.halls[0];
+    assert(hall0.inst.slots[hall0.inst.index(0, 2)].booth_id == 14);
+    // every hall's search threads report their stats, summed over the rounds
+    assert(result.stats.size() == 2);
+#ifdef LAYOUT_STATS
+    for (const auto& s : result.stats) {
+        assert(s.iterations > 0 && s.iterations <= 2000);
+        assert(s.local_search.wall_ms > 0.0);
+    }
+#endif
+
+    ParseError err;
+    // a booth no hall allows is reported, not silently dropped
+    Event shut;
+    string forbid = "halls 1\n2\n0 Food 5\n1 Tech 4\n1 2\n0\n1 1\n0\n1\n"
+                    "0 booth 1 forbid 0 0 0 1\n";
+    assert(ParseEventText(forbid.data(), forbid.size(), params, shut, err));
+    EventResult left_out = SolveEvent(shut, 100, 1, 2);
+    assert(left_out.unplaced == vector<int>{1});
+
+    Event bad;
+    string text = "halls 1\n1\n0 Food 5\n1 2\n0\n1 1\n0\n1\n2 booth 0 allow 0 0 0 0\n";
+    assert(!ParseEventText(text.data(), text.size(), params, bad, err));
+    assert(err.line == 9 && err.message == "rule for an unknown hall");
+    cout << "Test 18 passed: Multi-hall events" << endl;
+}
+
+// Test 19: Grid, CSV and JSON layout output
+void test_layout_output() {
+    GenParams g;
+    g.rows = 40;
+    g.cols = 50;
+    g.fill = 0.9;
+    g.seed = 4;
+    Layout L;
+    L.inst = GenerateInstance(g, Params());
+    GreedyValueOnly(L);
+    assert(L.inst.booths.size() > 1000); // four-digit ids
+
+    // grid cells stay separated and read back through ReadLayout
+    string grid = FormatLayout(L, LayoutFormat::Grid);
+    istringstream lines(grid);
+    string line;
+    getline(lines, line);
+    istringstream cells(line);
+    int tokens = 0;
+    for (string cell; cells >> cell;) tokens++;
+    assert(tokens == g.cols);
+    string file = "/tmp/layout_test_" + to_string(getpid()) + ".layout";
+    WriteLayout(file, L);
+    Instance back = L.inst;
+    ParseError err;
+    assert(ReadLayout(file, back, err));
+    for (size_t i = 0; i < back.slots.size(); i++) {
+        assert(back.slots[i].booth_id == L.inst.slots[i].booth_id);
+    }
+
+    // a booth placed twice is an error on the second cell
+    Layout two = GridLayout(2, 2, "AB..");
+    ofstream(file) << "0 1\n. 0\n";
+    assert(!ReadLayout(file, two.inst, err));
+    assert(err.line == 2 && err.col == 3 && err.message == "booth 0 placed twice");
+    remove(file.c_str());
+
+    // one CSV row per placed booth
+    string csv = FormatLayout(L, LayoutFormat::Csv);
+    size_t rows = count_if(csv.begin(), csv.end(), [](char ch) { return ch == '\n'; });
+    assert(rows == L.inst.booths.size() + 1);
+    const Slot* first = nullptr;
+    for (const auto& s : L.inst.slots) {
+        if (s.booth_id >= 0) {
+            first = &s;
+            break;
+        }
+    }
+    string row1 = csv.substr(csv.find('\n') + 1);
+    row1 = row1.substr(0, row1.find('\n'));
+    const Booth& b = L.inst.booths[first->booth_id];
+    assert(row1.rfind(to_string(first->booth_id) + "," + to_string(first->r) + "," +
+                      to_string(first->c) + "," + b.category + ",", 0) == 0);
+
+    // JSON carries the score breakdown
+    string json = FormatLayout(L, LayoutFormat::Json);
+    size_t at = json.find("\"score\":");
+    assert(at != string::npos);
+    assert(fabs(atof(json.c_str() + at + 8) - ComputeTotalScore(L)) < 1e-9);
+    assert(json.find("\"across_clash\":") != string::npos);
+    assert(count(json.begin(), json.end(), '[') == count(json.begin(), json.end(), ']'));
+    assert(json.find("\"layout\":[") != string::npos);
+
+    LayoutFormat f;
+    assert(ParseLayoutFormat("csv", f) && f == LayoutFormat::Csv);
+    assert(LayoutFormatFor("out.json") == LayoutFormat::Json);
+    assert(LayoutFormatFor("out.layout") == LayoutFormat::Grid);
+    cout << "Test 19 passed: Layout output" << endl;
+}
+
+// Test 20: RNG streams are reproducible and independent of thread count
+void test_rng_streams() {
+    Rng a(7, 3), b(7, 3), c(7, 4), d(8, 3);
+    bool differ_stream = false, differ_seed = false;
+    for (int i = 0; i < 100; i++) {
+        uint64_t x = a.Next();
+        assert(x == b.Next());
+        if (x != c.Next()) differ_stream = true;
+        if (x != d.Next()) differ_seed = true;
+    }
+    assert(differ_stream && differ_seed);
+
+    // Jump() leaves the stream it was called on
+    Rng j = a;
+    j.Jump();
+    assert(j.Next() != a.Next());
+
+    vector<int> hits(7, 0);
+    for (int i = 0; i < 7000; i++) hits[a.Below(7)]++;
+    for (int h : hits) assert(h > 800 && h < 1200);
+    for (int i = 0; i < 1000; i++) {
+        double u = a.Uniform();
+        assert(u >= 0.0 && u < 1.0);
+    }
+
+    // a partial shuffle keeps every element
+    vector<int> v(50);
+    for (int i = 0; i < 50; i++) v[i] = i;
+    SampleFront(v, 10, a);
+    vector<int> sorted = v;
+    sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < 50; i++) assert(sorted[i] == i);
+
+    // every sweep point draws from its own stream, so threads don't matter
+    Params params;
+    Instance inst = ReadInstance("data/small1.txt", params);
+    vector<double> wC = {0.0, 1.0, 2.0}, wX = {0.0, 1.0};
+    vector<SweepPoint> one = WeightSweep(inst, wC, wX, 300, 11, 1);
+    vector<SweepPoint> three = WeightSweep(inst, wC, wX, 300, 11, 3);
+    for (size_t i = 0; i < one.size(); i++) {
+        const auto& s1 = one[i].layout.inst.slots;
+        const auto& s3 = three[i].layout.inst.slots;
+        for (size_t k = 0; k < s1.size(); k++) assert(s1[k].booth_id == s3[k].booth_id);
+    }
+    cout << "Test 20 passed: RNG streams" << endl;
+}
+
+// A delta that forgets the across-aisle clashes
+static double DeltaWithoutAcross(const Layout& L, const Move& m) {
+    Layout rowsonly = L;
+    rowsonly.inst.params.wX = 0.0;
+    return MoveDelta(rowsonly, m);
+}
+
+// Test 21: Stress harness checks deltas and shrinks a failure
+void test_stress_harness() {
+    StressOptions opt;
+    opt.instances = 6;
+    opt.moves = 5000;
+    opt.max_rows = 20;
+    opt.max_cols = 20;
+    StressResult ok = RunStress(opt);
+    assert(!ok.failed && ok.moves > 0 && ok.full_checks > 0);
+
+    StressResult bad = RunStress(opt, DeltaWithoutAcross);
+    assert(bad.failed && bad.failure.move.a >= 0);
+    StressFailure f = bad.failure;
+    assert(DeltaMismatch(f.before, f.move, DeltaWithoutAcross, opt.tolerance));
+    ShrinkFailure(f, DeltaWithoutAcross, opt.tolerance);
+    assert(DeltaMismatch(f.before, f.move, DeltaWithoutAcross, opt.tolerance));
+
+    // what is left: the moved booth and one neighbor across the aisle
+    const Instance& in = f.before.inst;
+    assert(in.booths.size() <= 3);
+    assert(in.params.rows <= 3 && in.params.cols <= 3);
+    assert(fabs(f.delta - f.expected) > 0.1);
+    cout << "Test 21 passed: Stress harness" << endl;
+}
+
+// Test 22: Colored construction spreads categories over a grid coloring
+void test_colored_seed() {
+    Params params;
+    Layout greedy, colored;
+    greedy.inst = ReadInstance("data/greedy_trap.txt", params);
+    colored.inst = greedy.inst;
+    GreedySeed(greedy);
+    ColoredSeed(colored);
+    int placed = 0;
+    for (const auto& s : colored.inst.slots) {
+        if (s.booth_id >= 0) placed++;
+    }
+    assert(placed == (int)colored.inst.booths.size());
+    assert(ComputeRowClash(colored) + ComputeAcrossAisleClash(colored) <
+           ComputeRowClash(greedy) + ComputeAcrossAisleClash(greedy));
+
+    // no clashes at all when every category fits in one color class
+    GenParams g;
+    g.rows = 30;
+    g.cols = 30;
+    g.categories = 4;
+    for (Neighborhood n : {Neighborhood::Four, Neighborhood::Diagonal}) {
+        Params p;
+        p.neighborhood = n;
+        Layout L;
+        L.inst = GenerateInstance(g, p);
+        ColoredSeed(L);
+        assert(ComputeRowClash(L) == 0 && ComputeAcrossAisleClash(L) == 0);
+    }
+
+    // rules hold, and booths already placed keep their slot
+    Layout ruled;
+    ruled.inst = ReadInstance("data/constrained.txt", params);
+    int pinned = ruled.inst.index(0, 0);
+    ruled.inst.slots[pinned].booth_id = 5;
+    ColoredSeed(ruled);
+    assert(RulesHold(ruled));
+    assert(ruled.inst.slots[pinned].booth_id == 5);
+
+    Construction c;
+    assert(ParseConstruction("colored", c) && c == Construction::Colored);
+    assert(!ParseConstruction("random", c));
+    cout << "Test 22 passed: Colored construction" << endl;
+}
+
 int main() {
     cout << "Running sanity tests..." << endl;
 
@@ -169,6 +1099,23 @@ int main() {
     test_row_clash();
     test_across_aisle_clash();
     test_greedy_best_slot();
+    test_weight_sweep();
+    test_batch();
+    test_server_requests();
+    test_server_socket();
+    test_parse_errors();
+    test_binary_roundtrip();
+    test_generator();
+    test_search_stats();
+    test_trace();
+    test_neighborhood_policies();
+    test_category_conflicts();
+    test_placement_rules();
+    test_multi_hall();
+    test_layout_output();
+    test_rng_streams();
+    test_stress_harness();
+    test_colored_seed();
 
     cout << "\nAll tests passed!" << endl;
     return 0;
@@ -0,0 +1,97 @@
+#include "trace.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+// Rings are registered once per thread under the lock; recording into a
+// ring never takes it
+static mutex g_trace_mu;
+static vector<unique_ptr<TraceRing>> g_rings;
+static atomic<bool> g_enabled(false);
+static atomic<unsigned> g_generation(0); // bumped by StartTrace/StopTrace
+static size_t g_capacity = 0;
+static chrono::steady_clock::time_point g_start;
+
+void TraceRing::Snapshot(vector<TracePoint>& out) const {
+    size_t cap = points_.size();
+    size_t head = head_.load(memory_order_acquire);
+    size_t first = head + 1 > cap ? head + 1 - cap : 0;
+    vector<TracePoint> copy;
+    for (size_t i = first; i < head; i++) copy.push_back(points_[i % cap]);
+
+    // anything the writer lapped while we copied may be torn, and so may
+    // the slot it writes next (point head_after goes where head_after - cap
+    // was), so the oldest point kept is head_after - cap + 1. The spare
+    // slot makes that the full capacity.
+    size_t head_after = head_.load(memory_order_acquire);
+    size_t valid_from = head_after + 1 > cap ? head_after + 1 - cap : 0;
+    size_t skip = valid_from > first ? valid_from - first : 0;
+    if (skip > copy.size()) skip = copy.size();
+    out.insert(out.end(), copy.begin() + skip, copy.end());
+}
+
+void StartTrace(size_t capacity) {
+    lock_guard<mutex> lock(g_trace_mu);
+    g_rings.clear();
+    g_capacity = capacity;
+    g_start = chrono::steady_clock::now();
+    g_generation++;
+    g_enabled = true;
+}
+
+bool TraceEnabled() {
+    return g_enabled.load(memory_order_relaxed);
+}
+
+TraceRing* ThreadTrace() {
+    if (!TraceEnabled()) return nullptr;
+    thread_local TraceRing* ring = nullptr;
+    thread_local unsigned generation = 0;
+    unsigned current = g_generation.load(memory_order_acquire);
+    if (!ring || generation != current) {
+        lock_guard<mutex> lock(g_trace_mu);
+        g_rings.push_back(make_unique<TraceRing>(g_capacity));
+        ring = g_rings.back().get();
+        generation = current;
+    }
+    return ring;
+}
+
+double TraceNowMs() {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - g_start).count();
+}
+
+bool FlushTraceCsv(const string& filename) {
+    ofstream out(filename);
+    if (!out) {
+        cerr << "Error: cannot write to " << filename << endl;
+        return false;
+    }
+    out << "thread,t_ms,iter,score,best,row_clash,across_clash,move\n";
+    out << setprecision(12);
+
+    lock_guard<mutex> lock(g_trace_mu);
+    vector<TracePoint> points;
+    for (size_t t = 0; t < g_rings.size(); t++) {
+        points.clear();
+        g_rings[t]->Snapshot(points);
+        for (const auto& p : points) {
+            out << t << "," << p.t_ms << "," << p.iter << "," << p.score << ","
+                << p.best << "," << p.row_clash << "," << p.across_clash << ","
+                << (p.move == 0 ? "swap" : p.move == 1 ? "relocate" : "start") << "\n";
+        }
+    }
+    return (bool)out;
+}
+
+void StopTrace() {
+    lock_guard<mutex> lock(g_trace_mu);
+    g_enabled = false;
+    g_generation++;
+    g_rings.clear();
+}
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// One sample of search progress
+struct TracePoint {
+    double t_ms;       // since StartTrace
+    long long iter;
+    double score;
+    double best;
+    double row_clash;
+    double across_clash;
+    int move;          // -1 = start, 0 = swap, 1 = relocate
+};
+
+// Preallocated ring buffer written by a single thread without locks.
+// When full, the oldest points are overwritten.
+class TraceRing {
+public:
+    // one spare slot for the point being written, so a snapshot can always
+    // return `capacity` points that the writer is not touching
+    explicit TraceRing(size_t capacity) : points_((capacity ? capacity : 1) + 1) {}
+
+    void Record(const TracePoint& p) {
+        size_t h = head_.load(memory_order_relaxed);
+        points_[h % points_.size()] = p;
+        head_.store(h + 1, memory_order_release);
+    }
+
+    // Copy the points currently held, oldest first. Safe to call while the
+    // owner keeps recording; points overwritten during the copy are dropped.
+    void Snapshot(vector<TracePoint>& out) const;
+
+private:
+    vector<TracePoint> points_;
+    atomic<size_t> head_{0};
+};
+
+// Start recording; each thread gets its own ring of `capacity` points
+void StartTrace(size_t capacity);
+
+// true between StartTrace and StopTrace
+bool TraceEnabled();
+
+// Ring of the calling thread, or nullptr when tracing is off
+TraceRing* ThreadTrace();
+
+// Milliseconds since StartTrace
+double TraceNowMs();
+
+// Write every thread's points to a CSV file. Can be called at any time.
+bool FlushTraceCsv(const string& filename);
+
+// Stop recording and free the rings. No search may be running.
+void StopTrace();
+
+#endif
@@ -0,0 +1,385 @@
+#include "verify.h"
+#include "score.h"
+#include "generator.h"
+#include "rng.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+double MoveDelta(const Layout& L, const Move& m) {
+    if (L.inst.slots[m.b].booth_id < 0) return DeltaRelocateSlots(L, m.a, m.b);
+    return DeltaSwapSlots(L, m.a, m.b);
+}
+
+void ApplyMove(Layout& L, const Move& m) {
+    // a relocate is a swap with an empty slot
+    swap(L.inst.slots[m.a].booth_id, L.inst.slots[m.b].booth_id);
+}
+
+static bool Differ(double a, double b, double scale, double tolerance) {
+    return !(fabs(a - b) <= tolerance * (1.0 + fabs(scale)));
+}
+
+bool DeltaMismatch(const Layout& L, const Move& m, DeltaFn delta, double tolerance,
+                   double* got, double* want) {
+    double before = ComputeTotalScore(L);
+    double d = delta(L, m);
+    Layout after = L;
+    ApplyMove(after, m);
+    double expected = ComputeTotalScore(after) - before;
+    if (got) *got = d;
+    if (want) *want = expected;
+    return Differ(d, expected, before, tolerance);
+}
+
+// Random instance number i of a stress run
+static Instance StressInstance(const StressOptions& opt, Rng& rng) {
+    static const ValueDist kValues[] = {ValueDist::Uniform, ValueDist::Normal,
+                                        ValueDist::Heavy};
+    static const BonusPattern kBonus[] = {BonusPattern::Center, BonusPattern::Entrance,
+                                          BonusPattern::Aisles, BonusPattern::Random};
+    static const Neighborhood kNeighborhoods[] = {
+        Neighborhood::Four, Neighborhood::Diagonal, Neighborhood::WideAisle,
+        Neighborhood::BackToBack};
+
+    GenParams g;
+    g.rows = 1 + rng.Below(max(1, opt.max_rows));
+    g.cols = 1 + rng.Below(max(1, opt.max_cols));
+    g.fill = 0.2 + 0.8 * rng.Uniform();
+    g.categories = 1 + rng.Below(8);
+    g.values = kValues[rng.Below(3)];
+    g.blocked = 0.2 * rng.Uniform();
+    g.bonus = kBonus[rng.Below(4)];
+    g.seed = rng.Next();
+
+    Params params;
+    params.wC = 2.0 * rng.Uniform();
+    params.wX = 2.0 * rng.Uniform();
+    params.neighborhood = kNeighborhoods[rng.Below(4)];
+    Instance inst = GenerateInstance(g, params);
+
+    // half the instances get extra weighted or rewarding category pairs
+    if (rng.Below(2) && !inst.categories.empty()) {
+        int pairs = 1 + rng.Below(6);
+        for (int k = 0; k < pairs; k++) {
+            const string& a = inst.categories[rng.Below(inst.categories.size())];
+            const string& b = inst.categories[rng.Below(inst.categories.size())];
+            inst.conflicts.push_back({a, b, 3.0 * rng.Uniform() - 1.0});
+        }
+        CompileInstance(inst);
+    }
+
+    // a quarter get more category ids than the dense table takes, so the
+    // weights come from sparse_conflict: padding names no booth uses fill
+    // the ids up, and a few pairs of the real categories carry weights
+    if (rng.Below(4) == 0 && !inst.categories.empty()) {
+        vector<string> used = inst.categories;
+        for (int k = used.size(); k < kDenseConflictIds; k++) {
+            inst.conflicts.push_back({"Pad" + to_string(k), used[rng.Below(used.size())], 1.0});
+        }
+        int pairs = 1 + rng.Below(4);
+        for (int k = 0; k < pairs; k++) {
+            const string& a = used[rng.Below(used.size())];
+            const string& b = used[rng.Below(used.size())];
+            inst.conflicts.push_back({a, b, 3.0 * rng.Uniform() - 1.0});
+        }
+        CompileInstance(inst);
+    }
+
+    // a third get placement rules (booth or category rectangles, allowed
+    // or forbidden), so the moves are masked the way local search masks them
+    if (rng.Below(3) == 0 && !inst.booths.empty()) {
+        int rules = 1 + rng.Below(4);
+        for (int k = 0; k < rules; k++) {
+            PlacementRule rule;
+            rule.allow = rng.Below(2);
+            if (rng.Below(2)) {
+                rule.booth_id = rng.Below(inst.booths.size());
+            } else {
+                rule.booth_id = -1;
+                rule.category = inst.categories[rng.Below(inst.categories.size())];
+            }
+            rule.r0 = rng.Below(g.rows);
+            rule.r1 = rule.r0 + rng.Below(g.rows - rule.r0);
+            rule.c0 = rng.Below(g.cols);
+            rule.c1 = rule.c0 + rng.Below(g.cols - rule.c0);
+            inst.rules.push_back(rule);
+        }
+        CompileInstance(inst);
+    }
+    return inst;
+}
+
+// Booths placed into random free slots; a booth whose rules do not allow
+// the slot it drew stays unplaced
+static void RandomLayout(Layout& L, Rng& rng) {
+    vector<int> free_slots;
+    for (size_t i = 0; i < L.inst.slots.size(); i++) {
+        L.inst.slots[i].booth_id = -1;
+        if (!L.inst.slots[i].blocked) free_slots.push_back(i);
+    }
+    size_t n = min(free_slots.size(), L.inst.booths.size());
+    SampleFront(free_slots, n, rng);
+    for (size_t k = 0; k < n; k++) {
+        if (L.inst.Allowed(k, free_slots[k])) L.inst.slots[free_slots[k]].booth_id = k;
+    }
+}
+
+// Find the first bad move of a window by checking each one against a
+// full rescore. False if every move passes on its own, which means the
+// running score drifted through rounding instead.
+static bool FindBadMove(Layout L, const vector<Move>& window, long first_index,
+                        DeltaFn delta, double tolerance, StressFailure& f) {
+    for (size_t k = 0; k < window.size(); k++) {
+        if (DeltaMismatch(L, window[k], delta, tolerance, &f.delta, &f.expected)) {
+            f.move_index = first_index + k;
+            f.before = move(L);
+            f.move = window[k];
+            return true;
+        }
+        ApplyMove(L, window[k]);
+    }
+    return false;
+}
+
+StressResult RunStress(const StressOptions& opt, DeltaFn delta) {
+    StressResult result;
+    for (int i = 0; i < opt.instances; i++) {
+        Rng rng(opt.seed, i);
+        Layout L;
+        L.inst = StressInstance(opt, rng);
+        RandomLayout(L, rng);
+
+        vector<int> placed, empty;
+        for (size_t s = 0; s < L.inst.slots.size(); s++) {
+            if (L.inst.slots[s].booth_id >= 0) placed.push_back(s);
+            else if (!L.inst.slots[s].blocked) empty.push_back(s);
+        }
+        if (placed.empty() || placed.size() + empty.size() < 2) continue;
+
+        // a full rescore is a few ns per slot and a delta a few dozen ns,
+        // so rescoring every slots/16 moves keeps the two about even
+        long check_every = max<long>(1, L.inst.slots.size() / 16);
+        double running = ComputeTotalScore(L);
+        Layout window_start = L;
+        vector<Move> window;
+        long window_first = 0;
+
+        for (long k = 0; k < opt.moves; k++) {
+            Move m;
+            int pa = rng.Below(placed.size());
+            m.a = placed[pa];
+            const Instance& in = L.inst;
+            bool allowed;
+            if (!empty.empty() && (placed.size() < 2 || rng.Below(2))) {
+                int eb = rng.Below(empty.size());
+                m.b = empty[eb];
+                allowed = in.Allowed(in.slots[m.a].booth_id, m.b);
+                if (allowed) {
+                    placed[pa] = m.b;
+                    empty[eb] = m.a;
+                }
+            } else {
+                int pb = rng.Below(placed.size() - 1);
+                if (pb >= pa) pb++;
+                m.b = placed[pb];
+                allowed = in.Allowed(in.slots[m.a].booth_id, m.b) &&
+                          in.Allowed(in.slots[m.b].booth_id, m.a);
+            }
+            // like local search, never score a move the rules forbid
+            if (allowed) {
+                running += delta(L, m);
+                ApplyMove(L, m);
+                window.push_back(m);
+                result.moves++;
+            }
+
+            if (window.size() < (size_t)check_every && k + 1 < opt.moves) continue;
+            double full = ComputeTotalScore(L);
+            result.full_checks++;
+            if (Differ(running, full, full, opt.tolerance)) {
+                result.failed = true;
+                StressFailure& f = result.failure;
+                f.instance = i;
+                if (!FindBadMove(window_start, window, window_first, delta,
+                                 opt.tolerance, f)) {
+                    // no single move is at fault: report the drift itself
+                    f.before = move(window_start);
+                    f.delta = running;
+                    f.expected = full;
+                }
+                return result;
+            }
+            // resync so rounding never accumulates across windows
+            running = full;
+            window_start = L;
+            window_first = k + 1;
+            window.clear();
+        }
+    }
+    return result;
+}
+
+static bool StillFails(const StressFailure& f, DeltaFn delta, double tolerance) {
+    return DeltaMismatch(f.before, f.move, delta, tolerance);
+}
+
+// Apply edit to a copy of f and keep it if the copy still fails
+template <typename Edit>
+static bool TryEdit(StressFailure& f, DeltaFn delta, double tolerance, Edit edit) {
+    StressFailure candidate = f;
+    if (!edit(candidate)) return false;
+    if (!StillFails(candidate, delta, tolerance)) return false;
+    f = move(candidate);
+    return true;
+}
+
+// Drop row `row` (or column `col`) from the grid, renumbering the slots
+static bool DropLine(StressFailure& f, int row, int col) {
+    Instance& in = f.before.inst;
+    const Slot& sa = in.slots[f.move.a];
+    const Slot& sb = in.slots[f.move.b];
+    if (sa.r == row || sb.r == row || sa.c == col || sb.c == col) return false;
+    int rows = in.params.rows - (row >= 0), cols = in.params.cols - (col >= 0);
+    if (rows < 1 || cols < 1) return false;
+
+    vector<Slot> slots;
+    slots.reserve((size_t)rows * cols);
+    Move m;
+    for (size_t i = 0; i < in.slots.size(); i++) {
+        Slot s = in.slots[i];
+        if (s.r == row || s.c == col) continue;
+        if (row >= 0 && s.r > row) s.r--;
+        if (col >= 0 && s.c > col) s.c--;
+        if ((int)i == f.move.a) m.a = slots.size();
+        if ((int)i == f.move.b) m.b = slots.size();
+        slots.push_back(s);
+    }
+    in.slots = move(slots);
+    in.params.rows = rows;
+    in.params.cols = cols;
+    f.move = m;
+    CompileInstance(in);
+    return true;
+}
+
+// Keep only the booths still on the grid, renumbered in slot order
+static bool CompactBooths(StressFailure& f) {
+    Instance& in = f.before.inst;
+    vector<Booth> booths;
+    for (auto& s : in.slots) {
+        if (s.booth_id < 0) continue;
+        Booth b = in.booths[s.booth_id];
+        b.id = booths.size();
+        s.booth_id = b.id;
+        booths.push_back(b);
+    }
+    if (booths.size() == in.booths.size()) return false;
+    in.booths = move(booths);
+    CompileInstance(in);
+    return true;
+}
+
+// Remove the booths in slots[from, to) of the list, except the moved ones
+static bool ClearSlots(StressFailure& f, const vector<int>& slots, size_t from, size_t to) {
+    for (size_t k = from; k < to; k++) f.before.inst.slots[slots[k]].booth_id = -1;
+    return true;
+}
+
+void ShrinkFailure(StressFailure& f, DeltaFn delta, double tolerance) {
+    if (f.move.a < 0) return; // rounding drift, nothing to shrink
+
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        // rows and columns, last first so the indices stay valid. Dropping
+        // one row changes which rows pair up back to back, so also try two.
+        for (int r = f.before.inst.params.rows - 1; r >= 0; r--) {
+            if (r >= f.before.inst.params.rows) continue;
+            if (TryEdit(f, delta, tolerance,
+                        [&](StressFailure& c) { return DropLine(c, r, -1); }) ||
+                (r > 0 && TryEdit(f, delta, tolerance, [&](StressFailure& c) {
+                     return DropLine(c, r, -1) && DropLine(c, r - 1, -1);
+                 }))) {
+                progress = true;
+            }
+        }
+        for (int col = f.before.inst.params.cols - 1; col >= 0; col--) {
+            if (col >= f.before.inst.params.cols) continue;
+            progress |= TryEdit(f, delta, tolerance,
+                                [&](StressFailure& c) { return DropLine(c, -1, col); });
+        }
+
+        // other booths, in halves, then quarters, ... then one at a time
+        vector<int> others;
+        for (size_t i = 0; i < f.before.inst.slots.size(); i++) {
+            if ((int)i == f.move.a || (int)i == f.move.b) continue;
+            if (f.before.inst.slots[i].booth_id >= 0) others.push_back(i);
+        }
+        for (size_t chunk = max<size_t>(1, others.size() / 2); chunk >= 1; chunk /= 2) {
+            for (size_t from = 0; from < others.size();) {
+                size_t to = min(others.size(), from + chunk);
+                if (TryEdit(f, delta, tolerance, [&](StressFailure& c) {
+                        return ClearSlots(c, others, from, to);
+                    })) {
+                    others.erase(others.begin() + from, others.begin() + to);
+                    progress = true;
+                } else {
+                    from = to;
+                }
+            }
+            if (chunk == 1) break;
+        }
+
+        // rules only limit which moves are drawn, so they can all go at once
+        if (!f.before.inst.rules.empty()) {
+            progress |= TryEdit(f, delta, tolerance, [](StressFailure& c) {
+                c.before.inst.rules.clear();
+                CompileInstance(c.before.inst);
+                return true;
+            });
+        }
+
+        // conflicts the same way, so the padding of a sparse table goes fast
+        size_t conflicts = f.before.inst.conflicts.size();
+        for (size_t chunk = max<size_t>(1, conflicts / 2); conflicts > 0; chunk /= 2) {
+            for (size_t from = 0; from < f.before.inst.conflicts.size();) {
+                size_t to = min(f.before.inst.conflicts.size(), from + chunk);
+                if (TryEdit(f, delta, tolerance, [&](StressFailure& c) {
+                        auto& list = c.before.inst.conflicts;
+                        list.erase(list.begin() + from, list.begin() + to);
+                        CompileInstance(c.before.inst);
+                        return true;
+                    })) {
+                    progress = true;
+                } else {
+                    from = to;
+                }
+            }
+            if (chunk == 1) break;
+        }
+    }
+
+    TryEdit(f, delta, tolerance, CompactBooths);
+
+    // simpler numbers, one kind at a time
+    TryEdit(f, delta, tolerance, [](StressFailure& c) {
+        for (auto& s : c.before.inst.slots) s.bonus = 0.0;
+        return true;
+    });
+    TryEdit(f, delta, tolerance, [](StressFailure& c) {
+        for (auto& b : c.before.inst.booths) b.value = 1.0;
+        return true;
+    });
+    TryEdit(f, delta, tolerance, [](StressFailure& c) {
+        c.before.inst.params.wC = 1.0;
+        return true;
+    });
+    TryEdit(f, delta, tolerance, [](StressFailure& c) {
+        c.before.inst.params.wX = 1.0;
+        return true;
+    });
+    DeltaMismatch(f.before, f.move, delta, tolerance, &f.delta, &f.expected);
+}
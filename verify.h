@@ -0,0 +1,67 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "model.h"
+#include <cstdint>
+
+using namespace std;
+
+// A local search move on slot indices: swap the booths in slots a and b,
+// or relocate the booth in a to b if b is empty
+struct Move {
+    int a = -1, b = -1;
+};
+
+// Incremental score change of a move, as the solver computes it
+double MoveDelta(const Layout& L, const Move& m);
+using DeltaFn = double (*)(const Layout& L, const Move& m);
+
+void ApplyMove(Layout& L, const Move& m);
+
+// Rescore the layout before and after the move with ComputeTotalScore and
+// compare the difference with delta(L, m). True if they differ by more
+// than tolerance * (1 + |score|). got/want receive both values.
+bool DeltaMismatch(const Layout& L, const Move& m, DeltaFn delta, double tolerance,
+                   double* got = nullptr, double* want = nullptr);
+
+struct StressOptions {
+    int instances = 20;
+    long moves = 100000; // per instance
+    int max_rows = 100, max_cols = 100;
+    uint64_t seed = 1;
+    double tolerance = 1e-9;
+};
+
+// The first move whose delta disagrees with a full rescore
+struct StressFailure {
+    int instance = -1;
+    long move_index = -1;
+    Layout before; // the layout just before the move
+    Move move;
+    double delta = 0.0;    // from the delta function
+    double expected = 0.0; // from rescoring
+};
+
+struct StressResult {
+    long moves = 0;
+    long full_checks = 0;
+    bool failed = false;
+    StressFailure failure;
+};
+
+// Generate random instances (size, fill, categories, neighborhood, weights
+// and category conflicts all vary; some have more categories than the
+// dense conflict table takes, some have placement rules) and apply random
+// swaps and relocates that the rules allow to a random layout, keeping a
+// running score from the deltas. The running
+// score is compared with ComputeTotalScore every few moves, so the full
+// rescores cost about as much as the moves. On a mismatch the moves since
+// the last good check are replayed one by one to find the bad one.
+StressResult RunStress(const StressOptions& opt, DeltaFn delta = MoveDelta);
+
+// Shrink a failure while it still fails: drop grid rows and columns,
+// remove other booths, rules, conflicts and unplaced booths, and flatten bonuses,
+// values and weights. What is left is a minimal reproducer.
+void ShrinkFailure(StressFailure& f, DeltaFn delta, double tolerance);
+
+#endif